@@ -0,0 +1,631 @@
+#include "json.hpp"
+#include "json_document.hpp"
+#include "json_scan.hpp"
+#include "json_binary.hpp"
+#include "json_lazy.hpp"
+#include "FileBuffer.hpp"
+#include "ModIndex.hpp"
+
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <fstream>
+
+// Compares the DOM (fa_json::parse), arena (fa_json_document), event (fa_json_sax_parse) and lazy (fa_json_lazy) parsers on generated mod metadata,
+// reads info.json files through the binary cache, parses and dumps documents of different shapes
+// (optionally including real info.json files), then measures throughput of every scanning kernel the CPU supports on a large generated document.
+
+struct bench_result
+{
+	double best_ms = 0;
+	double median_ms = 0;
+};
+
+static bench_result measure(size_t repeats, const std::function<void()>& body)
+{
+	std::vector<double> times;
+
+	for (size_t i = 0; i < repeats; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto stop = std::chrono::steady_clock::now();
+
+		times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	return { times.front(), times[times.size() / 2] };
+}
+
+static void report(const std::string& name, size_t bytes, const bench_result& result)
+{
+	double mb = bytes / (1024.0 * 1024.0);
+
+	std::cout << std::left << std::setw(40) << name
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << result.best_ms << " ms (best)"
+		<< std::setw(12) << result.median_ms << " ms (median)"
+		<< std::setw(12) << std::setprecision(1) << mb / (result.median_ms / 1000.0) << " MB/s" << std::endl;
+}
+
+// info.json files look like the ones in the mods directory, with the required fields first and extra data after.
+static std::vector<std::string> generate_info_corpus(size_t count)
+{
+	std::vector<std::string> corpus;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		std::string name = "mod" + std::to_string(i);
+		std::string info = "{\n";
+
+		info += "\t\"name\": \"" + name + "\",\n";
+		info += "\t\"title\": \"Generated mod number " + std::to_string(i) + "\",\n";
+		info += "\t\"version\": \"1." + std::to_string(i % 10) + "." + std::to_string(i % 7) + "\",\n";
+		info += "\t\"factastra_version\": \"0.0\",\n";
+		info += "\t\"description\": \"" + std::string(200 + i % 300, 'd') + "\",\n";
+		info += "\t\"author\": \"Generated\",\n";
+		info += "\t\"dependencies\": [";
+
+		for (size_t j = 0; j < 20; j++)
+			info += std::string(j ? ", " : "") + "\"mod" + std::to_string((i + j * 31) % count) + " >= 0.1\"";
+
+		info += "],\n\t\"settings\": {";
+
+		for (size_t j = 0; j < 30; j++)
+			info += std::string(j ? ", " : "") + "\"setting" + std::to_string(j) + "\": [" + std::to_string(j) + ", " + std::to_string(j * 10) + ".5, \"value\"]";
+
+		info += "}\n}\n";
+
+		corpus.push_back(info);
+	}
+
+	return corpus;
+}
+
+static std::string generate_configuration(size_t mods)
+{
+	std::string config = "{\n\t\"directories\": [\"__appdata__/mods/\", \"__root__/data/\"],\n\t\"additional\": [";
+
+	for (size_t i = 0; i < mods / 10; i++)
+		config += std::string(i ? ", " : "") + "\"__local__/extra/additional_mod" + std::to_string(i) + "_1.0.0.zip\"";
+
+	config += "],\n\t\"ignored\": [";
+
+	for (size_t i = 0; i < mods / 10; i++)
+		config += std::string(i ? ", " : "") + "\"ignored_mod" + std::to_string(i) + "\"";
+
+	config += "],\n\t\"configuration\": {\n";
+
+	for (size_t i = 0; i < mods; i++)
+		config += std::string(i ? ",\n" : "") + "\t\t\"mod" + std::to_string(i) + "\": " + std::to_string(i % 2);
+
+	config += "\n\t}\n}\n";
+
+	return config;
+}
+
+// Indented data-stage like document with long strings, about the given size
+static std::string generate_large_document(size_t bytes)
+{
+	std::string document = "[\n";
+
+	for (size_t i = 0; document.size() < bytes; i++)
+	{
+		document += std::string(i ? ",\n" : "") + "\t{\n";
+		document += "\t\t\"type\": \"assembling-machine\",\n";
+		document += "\t\t\"name\": \"entity-" + std::to_string(i) + "\",\n";
+		document += "\t\t\"localised_description\": \"" + std::string(64 + i % 512, 'x') + "\",\n";
+		document += "\t\t\"escaped\": \"path\\\\to\\\\file " + std::to_string(i) + "\",\n";
+		document += "\t\t\"flags\": [\n\t\t\t\"placeable-neutral\",\n\t\t\t\"player-creation\"\n\t\t],\n";
+		document += "\t\t\"speed\": " + std::to_string(i % 100) + "\n";
+		document += "\t}";
+	}
+
+	document += "\n]\n";
+
+	return document;
+}
+
+// Prototype table full of numeric stats
+static std::string generate_numeric_document(size_t entries)
+{
+	std::string document = "[";
+
+	for (size_t i = 0; i < entries; i++)
+	{
+		document += std::string(i ? "," : "") + "{\"health\":" + std::to_string(i % 5000)
+			+ ",\"speed\":" + std::to_string(i % 97) + "." + std::to_string(i % 1000)
+			+ ",\"energy\":-" + std::to_string(i % 13) + ".25e3"
+			+ ",\"position\":[" + std::to_string(i * 7919 % 100000) + ".5," + std::to_string(i) + ",-0.125]}";
+	}
+
+	document += "]";
+
+	return document;
+}
+
+// Objects and arrays nested to the given depth, repeated until the document has about the given size
+static std::string generate_nested_document(size_t bytes, size_t depth)
+{
+	std::string document = "[";
+
+	for (size_t i = 0; document.size() < bytes; i++)
+	{
+		document += i ? "," : "";
+
+		for (size_t d = 0; d < depth; d++)
+			document += d % 2 ? "[" : "{\"child\":";
+
+		document += std::to_string(i);
+
+		for (size_t d = depth; d-- > 0;)
+			document += d % 2 ? "]" : "}";
+	}
+
+	document += "]";
+
+	return document;
+}
+
+// A single object with many distinct keys
+static std::string generate_wide_object(size_t members)
+{
+	std::string document = "{";
+
+	for (size_t i = 0; i < members; i++)
+		document += std::string(i ? "," : "") + "\"key" + std::to_string(i) + "\":" + std::to_string(i);
+
+	document += "}";
+
+	return document;
+}
+
+// Long strings, a part of them with escapes and non-ASCII characters
+static std::string generate_string_document(size_t bytes)
+{
+	std::string document = "[";
+
+	for (size_t i = 0; document.size() < bytes; i++)
+	{
+		document += std::string(i ? "," : "") + "\"" + std::string(4096 + i % 4096, 'a' + i % 26);
+
+		if (i % 4 == 0)
+			document += "\\n\\t\\\"\\u00e9\\ud83d\\ude00 \xc5\xbc\xc3\xb3\xc5\x82\xc4\x87";
+
+		document += "\"";
+	}
+
+	document += "]";
+
+	return document;
+}
+
+// info.json files found under the directory, e.g. a real mods folder
+static std::vector<std::string> read_info_files(const std::filesystem::path& directory)
+{
+	std::vector<std::string> files;
+	std::error_code ec;
+
+	for (auto it = std::filesystem::recursive_directory_iterator(directory, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (it->path().filename() != "info.json")
+			continue;
+
+		fa_FileBuffer file;
+
+		if (file.open(it->path()))
+			files.emplace_back(file.view());
+	}
+
+	return files;
+}
+
+// Discards everything written to it, so that streamed dumps measure only the serializer
+class counting_buffer : public std::streambuf
+{
+public:
+	size_t size = 0;
+
+protected:
+	std::streamsize xsputn(const char*, std::streamsize count) override
+	{
+		size += count;
+		return count;
+	}
+
+	int_type overflow(int_type c) override
+	{
+		size++;
+		return c;
+	}
+};
+
+// Visits every event, so that the whole document is walked
+class counting_handler : public fa_json_handler
+{
+public:
+	size_t events = 0;
+
+	bool start_object() override { events++; return true; }
+	bool key(const std::string&) override { events++; return true; }
+	bool end_object() override { events++; return true; }
+	bool start_array() override { events++; return true; }
+	bool end_array() override { events++; return true; }
+	bool string(const std::string&) override { events++; return true; }
+	bool integer(fa_json::integer) override { events++; return true; }
+	bool floating(fa_json::floating) override { events++; return true; }
+};
+
+// Reads the same fields fa_ModManager::load_mod_info does and stops once all of them are known
+class info_handler : public fa_json_handler
+{
+public:
+	std::map<std::string, std::string> fields;
+
+	void reset()
+	{
+		fields = { { "factastra_version", "" }, { "name", "" }, { "title", "" }, { "version", "" }, { "description", "" } };
+		remaining = fields.size();
+		depth = 0;
+		current = 0;
+	}
+
+	bool start_object() override { depth++; current = 0; return true; }
+	bool end_object() override { depth--; return true; }
+	bool start_array() override { depth++; current = 0; return true; }
+	bool end_array() override { depth--; return true; }
+
+	bool key(const std::string& key) override
+	{
+		auto it = fields.find(key);
+		current = depth == 1 && it != fields.end() ? &it->second : 0;
+		return true;
+	}
+
+	bool string(const std::string& value) override
+	{
+		if (current)
+		{
+			*current = value;
+			current = 0;
+			return --remaining != 0;
+		}
+
+		return true;
+	}
+
+private:
+	size_t remaining = 0;
+	size_t depth = 0;
+	std::string* current = 0;
+};
+
+int main(int argc, const char** argv)
+{
+	size_t mod_count = argc > 1 ? std::stoul(argv[1]) : 2000;
+	size_t repeats = argc > 2 ? std::stoul(argv[2]) : 15;
+	size_t large_mb = argc > 3 ? std::stoul(argv[3]) : 32;
+	std::filesystem::path info_directory = argc > 4 ? argv[4] : "";
+
+	auto info_corpus = generate_info_corpus(mod_count);
+	auto configuration = generate_configuration(mod_count * 10);
+
+	size_t info_bytes = 0;
+
+	for (const auto& info : info_corpus)
+		info_bytes += info.size();
+
+	std::cout << "info.json corpus: " << info_corpus.size() << " files, " << info_bytes << " bytes" << std::endl;
+	std::cout << "configuration.json: " << configuration.size() << " bytes" << std::endl << std::endl;
+
+	fa_json_error err;
+	size_t sink = 0;
+
+	report("info.json DOM", info_bytes, measure(repeats, [&]() {
+		for (const auto& info : info_corpus)
+		{
+			fa_json value;
+			value.parse(info, &err);
+			sink += std::get<fa_json::string>(std::get<fa_json::object>(value).at("name")).size();
+		}
+		}));
+
+	report("info.json arena", info_bytes, measure(repeats, [&]() {
+		for (const auto& info : info_corpus)
+		{
+			fa_json_document document;
+			document.parse(info, &err);
+			sink += document.root().find("name")->get_string().size();
+		}
+		}));
+
+	report("info.json SAX (full)", info_bytes, measure(repeats, [&]() {
+		for (const auto& info : info_corpus)
+		{
+			counting_handler handler;
+			fa_json_sax_parse(info, handler, &err);
+			sink += handler.events;
+		}
+		}));
+
+	report("info.json SAX (early stop)", info_bytes, measure(repeats, [&]() {
+		info_handler handler;
+
+		for (const auto& info : info_corpus)
+		{
+			handler.reset();
+			fa_json_sax_parse(info, handler, &err);
+			sink += handler.fields["name"].size();
+		}
+		}));
+
+	// Binary cache, on the corpus written to disk
+	auto cache_directory = std::filesystem::temp_directory_path() / "fa_json_bench";
+	std::vector<std::filesystem::path> info_files;
+
+	std::filesystem::create_directories(cache_directory);
+
+	for (size_t i = 0; i < info_corpus.size(); i++)
+	{
+		info_files.push_back(cache_directory / ("info_" + std::to_string(i) + ".json"));
+		std::ofstream(info_files.back(), std::ios::binary) << info_corpus[i];
+	}
+
+	report("info.json files DOM", info_bytes, measure(repeats, [&]() {
+		for (const auto& path : info_files)
+		{
+			fa_FileBuffer file;
+			file.open(path);
+
+			fa_json value;
+			value.parse(file.view(), &err);
+			sink += std::get<fa_json::string>(std::get<fa_json::object>(value).at("name")).size();
+		}
+		}));
+
+	report("info.json files cache build", info_bytes, measure(repeats, [&]() {
+		for (const auto& path : info_files)
+		{
+			std::error_code ec;
+			std::filesystem::remove(fa_json_cache::cache_path(path), ec);
+
+			fa_json_cache cache;
+			cache.load(path, &err);
+			sink += cache.root().find("name").get_string().size();
+		}
+		}));
+
+	report("info.json files cache hit", info_bytes, measure(repeats, [&]() {
+		for (const auto& path : info_files)
+		{
+			fa_json_cache cache;
+			cache.load(path, &err);
+			sink += cache.root().find("name").get_string().size() + cache.from_cache();
+		}
+		}));
+
+	// Mod index, as used at startup with an unchanged mods folder
+	std::vector<std::filesystem::path> mod_directories;
+
+	for (size_t i = 0; i < info_corpus.size(); i++)
+	{
+		mod_directories.push_back(cache_directory / ("mod" + std::to_string(i)));
+		std::filesystem::create_directories(mod_directories.back());
+		std::ofstream(mod_directories.back() / "info.json", std::ios::binary) << info_corpus[i];
+	}
+
+	{
+		fa_ModIndex index;
+		index.load(cache_directory / "mod_index.fabin");
+
+		for (const auto& directory : mod_directories)
+		{
+			fa_ModIndex::entry entry;
+			index.find(directory, &entry.source);
+			entry.mod.name = directory.filename().string();
+			index.update(directory, entry);
+		}
+
+		index.save();
+	}
+
+	report("mod index load + lookups", info_bytes, measure(repeats, [&]() {
+		fa_ModIndex index;
+		index.load(cache_directory / "mod_index.fabin");
+
+		for (const auto& directory : mod_directories)
+		{
+			fa_ModIndex::stamp source;
+			sink += index.find(directory, &source) != 0;
+		}
+		}));
+
+	std::error_code remove_error;
+	std::filesystem::remove_all(cache_directory, remove_error);
+
+	report("configuration.json DOM", configuration.size(), measure(repeats, [&]() {
+		fa_json value;
+		value.parse(configuration, &err);
+		sink += std::get<fa_json::object>(value).size();
+		}));
+
+	report("configuration.json arena", configuration.size(), measure(repeats, [&]() {
+		fa_json_document document;
+		document.parse(configuration, &err);
+		sink += document.root().size();
+		}));
+
+	report("configuration.json SAX", configuration.size(), measure(repeats, [&]() {
+		counting_handler handler;
+		fa_json_sax_parse(configuration, handler, &err);
+		sink += handler.events;
+		}));
+
+	report("configuration.json lazy (directories)", configuration.size(), measure(repeats, [&]() {
+		fa_json_lazy document;
+		document.parse(configuration, &err);
+		sink += document.at("/directories").elements().size();
+		}));
+
+	// Numbers
+	auto numeric = generate_numeric_document(mod_count * 100);
+
+	std::cout << std::endl << "Numeric document: " << numeric.size() << " bytes" << std::endl;
+
+	report("numbers DOM", numeric.size(), measure(repeats, [&]() {
+		fa_json value;
+		value.parse(numeric, &err);
+		sink += std::get<fa_json::arr>(value).size();
+		}));
+
+	report("numbers arena", numeric.size(), measure(repeats, [&]() {
+		fa_json_document document;
+		document.parse(numeric, &err);
+		sink += document.root().size();
+		}));
+
+	report("numbers lazy (one element)", numeric.size(), measure(repeats, [&]() {
+		fa_json_lazy document;
+		document.parse(numeric, &err);
+		sink += document.at("/" + std::to_string(mod_count * 50) + "/health").get_integer();
+		}));
+
+	fa_json numeric_value;
+	numeric_value.parse(numeric, &err);
+
+	report("numbers DOM key lookups", numeric.size(), measure(repeats, [&]() {
+		fa_json_atom health("health");
+		fa_json_atom position("position");
+
+		for (const auto& element : std::get<fa_json::arr>(numeric_value))
+		{
+			const auto& object = std::get<fa_json::object>(element);
+			sink += std::get<fa_json::integer>(object.at(health)) + object.count(position);
+		}
+		}));
+
+	report("numbers dump (string)", numeric.size(), measure(repeats, [&]() {
+		sink += numeric_value.dump().size();
+		}));
+
+	report("numbers dump (pretty string)", numeric.size(), measure(repeats, [&]() {
+		sink += numeric_value.dump(true).size();
+		}));
+
+	report("numbers dump (stream)", numeric.size(), measure(repeats, [&]() {
+		counting_buffer buffer;
+		std::ostream output(&buffer);
+		numeric_value.dump(output);
+		sink += buffer.size;
+		}));
+
+	// Shapes that stress different parts of the parsers and the serializer
+	std::vector<std::pair<std::string, std::string>> shapes = {
+		{ "nested", generate_nested_document(large_mb * 1024 * 1024 / 4, 64) },
+		{ "wide object", generate_wide_object(mod_count * 50) },
+		{ "long strings", generate_string_document(large_mb * 1024 * 1024 / 4) },
+	};
+
+	if (!info_directory.empty())
+	{
+		// Real files are concatenated into one array, so they are measured as a single document
+		std::string files = "[";
+
+		for (const auto& file : read_info_files(info_directory))
+			files += (files.size() > 1 ? "," : "") + file;
+
+		shapes.push_back({ "info.json files in " + info_directory.string(), files + "]" });
+	}
+
+	for (const auto& [shape, document] : shapes)
+	{
+		std::cout << std::endl << shape << ": " << document.size() << " bytes" << std::endl;
+
+		report(shape + " DOM", document.size(), measure(repeats, [&]() {
+			fa_json value;
+			value.parse(document, &err);
+			sink += value.index();
+			}));
+
+		report(shape + " arena", document.size(), measure(repeats, [&]() {
+			fa_json_document parsed;
+			parsed.parse(document, &err);
+			sink += parsed.root().size();
+			}));
+
+		report(shape + " SAX", document.size(), measure(repeats, [&]() {
+			counting_handler handler;
+			fa_json_sax_parse(document, handler, &err);
+			sink += handler.events;
+			}));
+
+		fa_json value;
+		value.parse(document, &err);
+
+		report(shape + " dump", document.size(), measure(repeats, [&]() {
+			sink += value.dump().size();
+			}));
+	}
+
+	// Scanning kernels
+	auto large = generate_large_document(large_mb * 1024 * 1024);
+
+	std::cout << std::endl << "Generated document: " << large.size() << " bytes" << std::endl;
+
+	fa_json_scan_kernel best = fa_json_best_scan_kernel();
+
+	for (auto kernel : { fa_json_scan_kernel::scalar, fa_json_scan_kernel::sse2, fa_json_scan_kernel::avx2 })
+	{
+		if (!fa_json_use_scan_kernel(kernel))
+			continue;
+
+		std::string name = fa_json_scan_kernel_name(kernel);
+
+		report("scan " + name, large.size(), measure(repeats, [&]() {
+			// Whitespace and strings alternate, roughly what the parsers do
+			const char* it = large.data();
+			const char* end = large.data() + large.size();
+
+			while (it != end)
+			{
+				it = fa_json_skip_whitespace(it, end);
+
+				if (it != end && *it == '"')
+					it = fa_json_find_string_special(it + 1, end);
+
+				if (it != end)
+					it++;
+			}
+
+			sink += it - large.data();
+			}));
+
+		report("document parse " + name, large.size(), measure(repeats, [&]() {
+			fa_json_document document;
+			document.parse(large, &err);
+			sink += document.root().size();
+			}));
+
+		report("SAX parse " + name, large.size(), measure(repeats, [&]() {
+			counting_handler handler;
+			fa_json_sax_parse(large, handler, &err);
+			sink += handler.events;
+			}));
+	}
+
+	fa_json_use_scan_kernel(best);
+
+	if (err.code != fa_json_errno::ok)
+	{
+		std::cerr << "Parse error: " << err.description << std::endl;
+		return 1;
+	}
+
+	// Keeps the results observable, so that nothing is optimized away
+	std::cout << std::endl << "checksum: " << sink << std::endl;
+
+	return 0;
+}
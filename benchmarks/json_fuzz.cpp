@@ -0,0 +1,244 @@
+#include "json.hpp"
+#include "json_document.hpp"
+#include "json_lazy.hpp"
+#include "json_binary.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+// Round trip harness for the JSON parsers: parse -> dump -> parse has to give back the same value,
+// and all the parsers have to agree on whether the input is valid.
+// Built with FA_JSON_LIBFUZZER it is a libFuzzer target, otherwise it has its own main which runs
+// the given files or mutates a built-in corpus.
+
+// Visits every event, so that the whole input is walked
+class fuzz_handler : public fa_json_handler
+{
+public:
+	size_t events = 0;
+
+	bool start_object() override { events++; return true; }
+	bool key(const std::string&) override { events++; return true; }
+	bool end_object() override { events++; return true; }
+	bool start_array() override { events++; return true; }
+	bool end_array() override { events++; return true; }
+	bool string(const std::string&) override { events++; return true; }
+	bool integer(fa_json::integer) override { events++; return true; }
+	bool floating(fa_json::floating) override { events++; return true; }
+};
+
+static const char* failure = 0;
+
+static bool fail(const char* reason)
+{
+	failure = reason;
+	return false;
+}
+
+static bool check(std::string_view input)
+{
+	fa_json value;
+	fa_json_error err;
+
+	value.parse(input, &err);
+
+	fa_json_document document;
+	fa_json_error document_err;
+
+	document.parse(input, &document_err);
+
+	fuzz_handler handler;
+	fa_json_error sax_err;
+
+	fa_json_sax_parse(input, handler, &sax_err);
+
+	fa_json_lazy lazy;
+	fa_json_error lazy_err;
+
+	lazy.parse(input, &lazy_err);
+
+	// Which error is found first may differ, but not whether there is one
+	bool valid = err.code == fa_json_errno::ok;
+
+	if ((document_err.code == fa_json_errno::ok) != valid || (sax_err.code == fa_json_errno::ok) != valid || (lazy_err.code == fa_json_errno::ok) != valid)
+		return fail("parsers disagree on the input");
+
+	if (!valid)
+	{
+		if (err.position > input.size() || err.line == 0 || err.column == 0)
+			return fail("error position out of the input");
+
+		// A rejected document is empty
+		if (lazy.root())
+			return fail("lazy document of invalid input has a root");
+
+		return true;
+	}
+
+	if (document.root().to_json() != value)
+		return fail("arena document differs from the DOM");
+
+	if (lazy.root().decode(0) != value)
+		return fail("lazy document differs from the DOM");
+
+	std::string encoded;
+	fa_json_binary_encode(value, encoded);
+
+	if (fa_json_binary(encoded.data(), encoded.data() + encoded.size()).to_json() != value)
+		return fail("binary encoding does not round trip");
+
+	for (bool pretty : { false, true })
+	{
+		std::string dumped = value.dump(pretty);
+
+		fa_json reparsed;
+		reparsed.parse(dumped, &err);
+
+		if (err.code != fa_json_errno::ok)
+			return fail("dumped text does not parse");
+
+		if (reparsed != value)
+			return fail("parse -> dump -> parse changed the value");
+
+		if (reparsed.dump(pretty) != dumped)
+			return fail("dump is not stable");
+	}
+
+	return true;
+}
+
+#ifdef FA_JSON_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (!check(std::string_view((const char*)data, size)))
+	{
+		std::fprintf(stderr, "%s\n", failure);
+		std::abort();
+	}
+
+	return 0;
+}
+
+#else
+
+static const char* const seeds[] = {
+	"",
+	"{}",
+	"[]",
+	"{\"name\": \"base\", \"title\": \"Base mod\", \"version\": \"0.1.0\", \"factastra_version\": \"0.0\"}",
+	"{\"directories\": [\"__appdata__/mods/\"], \"additional\": [], \"configuration\": {\"base\": 1}}",
+	"[1, -2, 3.5, -0.25e3, 1E+2, 9223372036854775807, -9223372036854775808, 1.7976931348623157e308]",
+	"{\"a\": {\"b\": {\"c\": [[[], {}], [\"\\\\\", \"\\\"\"]]}}}",
+	"\"\\u0041\\u00e9\\u20ac\\ud83d\\ude00\\n\\t\\/\"",
+	"{\"k\": 1, \"k\": 2, \"\\u006b\": 3}",
+	"[{\"health\":100,\"speed\":0.15,\"position\":[1.5,2,-0.125]}]",
+};
+
+static std::string mutate(std::string input, std::mt19937_64& random)
+{
+	static const char tokens[] = "{}[]\":,\\-.0123456789eEu \n\t";
+
+	size_t steps = 1 + random() % 4;
+
+	for (size_t step = 0; step < steps; step++)
+	{
+		size_t at = input.empty() ? 0 : random() % (input.size() + 1);
+
+		switch (random() % 6)
+		{
+		case 0:
+			if (at < input.size())
+				input[at] = (char)random();
+			break;
+
+		case 1:
+			input.insert(input.begin() + at, tokens[random() % (sizeof(tokens) - 1)]);
+			break;
+
+		case 2:
+			input.erase(at, random() % 8);
+			break;
+
+		case 3:
+			input.insert(at, input.substr(random() % (input.size() + 1), random() % 16));
+			break;
+
+		case 4:
+			input.resize(at);
+			break;
+
+		default:
+			// Nesting
+			input.insert(at, std::string(random() % 64, random() % 2 ? '[' : '{'));
+		}
+	}
+
+	return input;
+}
+
+static bool run(std::string_view input)
+{
+	if (check(input))
+		return true;
+
+	std::fprintf(stderr, "%s, input (%zu bytes):\n%.*s\n", failure, input.size(), (int)input.size(), input.data());
+	return false;
+}
+
+// fa_json_fuzz [<iterations> [<seed>]] or fa_json_fuzz <file>...
+int main(int argc, const char** argv)
+{
+	if (argc > 1 && !std::isdigit((unsigned char)argv[1][0]))
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::ifstream file(argv[i], std::ios::binary);
+			std::string input(std::istreambuf_iterator<char>(file), {});
+
+			if (!run(input))
+				return 1;
+		}
+
+		std::printf("%d files ok\n", argc - 1);
+		return 0;
+	}
+
+	size_t iterations = argc > 1 ? std::stoul(argv[1]) : 100000;
+	std::mt19937_64 random(argc > 2 ? std::stoull(argv[2]) : 1);
+
+	std::vector<std::string> corpus(std::begin(seeds), std::end(seeds));
+
+	for (const auto& seed : corpus)
+	{
+		if (!run(seed))
+			return 1;
+	}
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		std::string input = mutate(corpus[random() % corpus.size()], random);
+
+		if (!run(input))
+			return 1;
+
+		// Valid mutations become seeds themselves, so the inputs keep growing in structure
+		fa_json value;
+		fa_json_error err;
+		value.parse(input, &err);
+
+		if (err.code == fa_json_errno::ok && corpus.size() < 4096 && input.size() < 4096)
+			corpus.push_back(input);
+	}
+
+	std::printf("%zu inputs ok\n", iterations + std::size(seeds));
+	return 0;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include "Logger.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Logs lines like those of a verbose mod scan, first into an std::ofstream ended with std::endl (one flush per line, the way
+// the game logged before), then through fa_LogStream and fa_Logger from one and from several threads.
+// Times cover the callers only, plus waiting for the writer at the end, so the cost of the file itself is included once.
+
+struct bench_result
+{
+	double best_ms = 0;
+	double median_ms = 0;
+};
+
+static bench_result measure(size_t repeats, const std::function<void()>& body)
+{
+	std::vector<double> times;
+
+	for (size_t i = 0; i < repeats; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto stop = std::chrono::steady_clock::now();
+
+		times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	return { times.front(), times[times.size() / 2] };
+}
+
+static void report(const std::string& name, size_t items, const bench_result& result)
+{
+	std::cout << std::left << std::setw(40) << name
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << result.best_ms << " ms (best)"
+		<< std::setw(12) << result.median_ms << " ms (median)"
+		<< std::setw(12) << std::setprecision(1) << result.median_ms * 1000000.0 / items << " ns/item" << std::endl;
+}
+
+// fa_log_bench [<lines> [<threads> [<repeats>]]]
+int main(int argc, const char** argv)
+{
+	size_t line_count = argc > 1 ? std::stoul(argv[1]) : 100000;
+	size_t thread_count = argc > 2 ? std::stoul(argv[2]) : 4;
+	size_t repeats = argc > 3 ? std::stoul(argv[3]) : 10;
+
+	auto path = std::filesystem::temp_directory_path() / "fa_log_bench.log";
+
+	std::cout << "lines: " << line_count << ", threads: " << thread_count << std::endl << std::endl;
+
+	report("std::ofstream, std::endl", line_count, measure(repeats, [&]() {
+		std::ofstream file(path);
+
+		for (size_t i = 0; i < line_count; i++)
+			file << "Loading mod at \"mods/mod" << i << "_1.2.3.zip\"." << std::endl;
+		}));
+
+	report("fa_LogStream, std::endl", line_count, measure(repeats, [&]() {
+		fa_Logger logger;
+		logger.set_overflow(fa_LogOverflow::block);
+		logger.open(std::ofstream(path));
+
+		{
+			fa_LogStream log(logger);
+
+			for (size_t i = 0; i < line_count; i++)
+				log << "Loading mod at \"mods/mod" << i << "_1.2.3.zip\"." << std::endl;
+		}
+
+		logger.close();
+		}));
+
+	report("fa_Logger, fields, " + std::to_string(thread_count) + " threads", line_count, measure(repeats, [&]() {
+		fa_Logger logger;
+		logger.set_overflow(fa_LogOverflow::block);
+		logger.open(std::ofstream(path));
+
+		std::vector<std::thread> threads;
+
+		for (size_t t = 0; t < thread_count; t++)
+		{
+			threads.emplace_back([&, t]() {
+				for (size_t i = t; i < line_count; i += thread_count)
+					logger.log(fa_LogLevel::info, "Loading mod", { { "mod", (uint64_t)i }, { "thread", (uint64_t)t } });
+				});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		logger.close();
+		}));
+
+	// Dropping instead of waiting, so the callers never stall on the disk
+	size_t dropped = 0;
+
+	report("fa_Logger, dropping, " + std::to_string(thread_count) + " threads", line_count, measure(repeats, [&]() {
+		fa_Logger logger(1024);
+		logger.open(std::ofstream(path));
+
+		std::vector<std::thread> threads;
+
+		for (size_t t = 0; t < thread_count; t++)
+		{
+			threads.emplace_back([&, t]() {
+				for (size_t i = t; i < line_count; i += thread_count)
+					logger.log(fa_LogLevel::info, "Loading mod", { { "mod", (uint64_t)i } });
+				});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		logger.close();
+		dropped += logger.dropped_count();
+		}));
+
+	std::cout << "  dropped: " << dropped / repeats << " lines per run" << std::endl;
+
+	std::filesystem::remove(path);
+
+	return 0;
+}
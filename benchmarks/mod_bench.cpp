@@ -0,0 +1,338 @@
+#include "ModGraph.hpp"
+#include "ModConfig.hpp"
+#include "ModFilter.hpp"
+
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// Builds the dependency graph of a large generated set of mods and measures parsing the dependency declarations,
+// matching their version constraints, building the graph (load order, cycles and problems included) and depth-limited dependency and dependent queries.
+
+struct bench_result
+{
+	double best_ms = 0;
+	double median_ms = 0;
+};
+
+static bench_result measure(size_t repeats, const std::function<void()>& body)
+{
+	std::vector<double> times;
+
+	for (size_t i = 0; i < repeats; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto stop = std::chrono::steady_clock::now();
+
+		times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	return { times.front(), times[times.size() / 2] };
+}
+
+static void report(const std::string& name, size_t items, const bench_result& result)
+{
+	std::cout << std::left << std::setw(40) << name
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << result.best_ms << " ms (best)"
+		<< std::setw(12) << result.median_ms << " ms (median)"
+		<< std::setw(12) << std::setprecision(1) << result.median_ms * 1000000.0 / items << " ns/item" << std::endl;
+}
+
+// Mods depend mostly on mods with lower numbers, the way libraries pile up under content mods.
+// With cycles, every hundredth mod also depends on a later one.
+static std::vector<std::vector<std::string>> generate_declarations(size_t count, size_t per_mod, bool with_cycles)
+{
+	std::mt19937_64 random(1);
+	std::vector<std::vector<std::string>> declarations(count);
+
+	for (size_t i = 1; i < count; i++)
+	{
+		for (size_t j = 0; j < per_mod; j++)
+		{
+			size_t target = random() % i;
+			std::string declaration;
+
+			switch (random() % 10)
+			{
+			case 0:
+				declaration = "? mod" + std::to_string(target) + " >= 1.0";
+				break;
+
+			case 1:
+				declaration = "! missing" + std::to_string(target);
+				break;
+
+			case 2:
+				declaration = "mod" + std::to_string(target);
+				break;
+
+			case 3:
+				declaration = "mod" + std::to_string(target) + " ~1." + std::to_string(random() % 4);
+				break;
+
+			case 4:
+				declaration = "mod" + std::to_string(target) + " 1.0 - 1." + std::to_string(random() % 4);
+				break;
+
+			default:
+				declaration = "mod" + std::to_string(target) + " >= 1." + std::to_string(random() % 3);
+			}
+
+			declarations[i].push_back(declaration);
+		}
+
+		if (with_cycles && i % 100 == 0 && i + 1 < count)
+			declarations[i].push_back("mod" + std::to_string(i + 1 + random() % (count - i - 1)));
+	}
+
+	return declarations;
+}
+
+static std::map<std::string, fa_Mod> generate_mods(const std::vector<std::vector<std::string>>& declarations)
+{
+	std::map<std::string, fa_Mod> mods;
+
+	for (size_t i = 0; i < declarations.size(); i++)
+	{
+		fa_Mod mod;
+		mod.name = "mod" + std::to_string(i);
+		mod.title = mod.name;
+		mod.is_zip = false;
+		mod.version = fa_Version(1, (uint32_t)(i % 4), 0);
+		mod.enabled = i % 50 != 49;
+
+		for (const auto& declaration : declarations[i])
+		{
+			mod.dependencies.emplace_back();
+			mod.dependencies.back().parse(declaration);
+		}
+
+		mods.insert({ mod.name, std::move(mod) });
+	}
+
+	return mods;
+}
+
+// fa_mod_bench [<mod count> [<dependencies per mod> [<repeats>]]]
+// Compiles random patterns made of the pieces the DFA and std::regex could disagree on, and checks that every filter
+// accepts the same patterns and matches the same names as std::regex_match. Returns the number of differences.
+static size_t check_filters(size_t pattern_count)
+{
+	static const char* const pieces[] = {
+		"a", "b", "-", "!", ".", "*", "+", "?", "^", "$", "|", "(", ")", "[", "]", "\\", "\\.", "\\]", "\\-", "\\d",
+		"[a-b]", "[^a]", "[--\\]", "[!-\\]", "[a-]", "[]", "[^]", "{2}", ".*", ".+"
+	};
+	static const char alphabet[] = "ab-!.]\\[";
+
+	std::mt19937_64 random(1);
+	size_t differences = 0;
+
+	for (size_t i = 0; i < pattern_count; i++)
+	{
+		std::string pattern;
+
+		for (size_t length = 1 + random() % 5; length; length--)
+			pattern += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+
+		std::regex expression;
+		bool valid = true;
+
+		try
+		{
+			expression = std::regex(pattern);
+		}
+		catch (const std::regex_error&)
+		{
+			valid = false;
+		}
+
+		fa_ModFilter filter;
+		std::string error;
+
+		if (filter.compile(pattern, &error) != valid)
+		{
+			std::cout << "filter " << pattern << (valid ? " is rejected, std::regex accepts it" : " is accepted, std::regex rejects it") << std::endl;
+			differences++;
+			continue;
+		}
+
+		if (!valid)
+			continue;
+
+		for (size_t j = 0; j < 50; j++)
+		{
+			std::string name;
+
+			for (size_t length = random() % 6; length; length--)
+				name += alphabet[random() % (sizeof(alphabet) - 1)];
+
+			if (filter.matches(name) != std::regex_match(name, expression))
+			{
+				std::cout << "filter " << pattern << " and std::regex disagree on \"" << name << "\"" << std::endl;
+				differences++;
+				break;
+			}
+		}
+	}
+
+	return differences;
+}
+
+int main(int argc, const char** argv)
+{
+	size_t mod_count = argc > 1 ? std::stoul(argv[1]) : 5000;
+	size_t per_mod = argc > 2 ? std::stoul(argv[2]) : 8;
+	size_t repeats = argc > 3 ? std::stoul(argv[3]) : 15;
+
+	auto declarations = generate_declarations(mod_count, per_mod, false);
+	size_t declaration_count = 0;
+
+	for (const auto& list : declarations)
+		declaration_count += list.size();
+
+	if (size_t differences = check_filters(20000))
+	{
+		std::cout << differences << " filters differ from std::regex" << std::endl;
+		return 1;
+	}
+
+	std::cout << "mods: " << mod_count << ", dependencies: " << declaration_count << std::endl << std::endl;
+
+	size_t sink = 0;
+
+	report("parse declarations", declaration_count, measure(repeats, [&]() {
+		fa_ModDependency dependency;
+
+		for (const auto& list : declarations)
+		{
+			for (const auto& declaration : list)
+				sink += dependency.parse(declaration);
+		}
+		}));
+
+	{
+		// Every declared constraint checked against every version the generated mods have
+		auto mods = generate_mods(declarations);
+		std::vector<uint64_t> versions;
+
+		for (uint32_t minor = 0; minor < 4; minor++)
+			versions.push_back(fa_Version(1, minor, 0).key());
+
+		report("match version constraints", declaration_count * versions.size(), measure(repeats, [&]() {
+			for (const auto& [name, mod] : mods)
+			{
+				for (const auto& dependency : mod.dependencies)
+				{
+					for (const auto& version : versions)
+						sink += dependency.constraint.allows(version);
+				}
+			}
+			}));
+
+		// Each kind of filter, against the plain std::regex the list command used before
+		static const char* const patterns[] = { "mod4242", "mod42.*", "mod[0-9]*7", "mod(1|2)\\d*" };
+		static const char* const kind_names[] = { "literal", "prefix", "dfa", "regex" };
+
+		fa_ModFilterCache filters;
+
+		for (const char* pattern : patterns)
+		{
+			std::string error;
+			auto filter = filters.get(pattern, &error);
+
+			report(std::string("filter, ") + kind_names[(int)filter->get_kind()] + " " + pattern, mods.size(), measure(repeats, [&]() {
+				sink += filter->select(mods).size();
+				}));
+
+			report(std::string("filter, std::regex ") + pattern, mods.size(), measure(repeats, [&]() {
+				std::regex expression(pattern);
+
+				for (const auto& [name, mod] : mods)
+					sink += std::regex_match(name, expression);
+				}));
+		}
+	}
+
+	for (bool with_cycles : { false, true })
+	{
+		auto mods = generate_mods(generate_declarations(mod_count, per_mod, with_cycles));
+		std::string suffix = with_cycles ? " (with cycles)" : "";
+
+		fa_ModGraph graph;
+
+		report("build graph, all mods" + suffix, mod_count, measure(repeats, [&]() {
+			graph.build(mods, false);
+			sink += graph.get_load_order().size();
+			}));
+
+		report("build graph, enabled mods" + suffix, mod_count, measure(repeats, [&]() {
+			graph.build(mods, true);
+			sink += graph.get_load_order().size();
+			}));
+
+		std::cout << "  load order: " << graph.get_load_order().size() << " mods, cycles: " << graph.get_cycles().size()
+			<< ", problems: " << graph.get_problems().size() << std::endl;
+
+		// Every tenth mod is queried
+		size_t queries = (graph.size() + 9) / 10;
+
+		for (size_t depth : { (size_t)1, (size_t)3, fa_ModGraph::all })
+		{
+			std::string depth_name = depth == fa_ModGraph::all ? "all" : std::to_string(depth);
+
+			report("dependencies, depth " + depth_name + suffix, queries, measure(repeats, [&]() {
+				for (uint32_t node = 0; node < graph.size(); node += 10)
+					sink += graph.dependencies(node, depth).size();
+				}));
+
+			report("dependents, depth " + depth_name + suffix, queries, measure(repeats, [&]() {
+				for (uint32_t node = 0; node < graph.size(); node += 10)
+					sink += graph.dependents(node, depth).size();
+				}));
+		}
+	}
+
+	{
+		// Ten times as many mods as in the graph, each configuration mentioning about two thirds of them
+		size_t config_mods = mod_count * 10;
+		std::mt19937_64 random(2);
+		fa_ModConfig current, loaded;
+
+		for (uint32_t id = 0; id < config_mods; id++)
+		{
+			if (random() % 3)
+				current.set(id, random() % 2);
+
+			if (random() % 3)
+				loaded.set(id, random() % 2);
+		}
+
+		std::cout << std::endl;
+
+		static const char* const operators[] = { "override", "or", "and", "xor", "nor", "nand", "xnor" };
+
+		for (const char* name : operators)
+		{
+			fa_ModConfig::merge_operator op;
+			fa_ModConfig::parse_operator(name, &op);
+
+			fa_ModConfig merged = current;
+
+			report("merge configuration, " + std::string(name), config_mods, measure(repeats, [&]() {
+				merged.merge(loaded, op);
+				sink += merged.get_enabled()[0];
+				}));
+		}
+	}
+
+	std::cout << std::endl << "checksum: " << sink << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,236 @@
+#include "ZipArchive.hpp"
+#include "json.hpp"
+
+#include <minizip/mz.h>
+#include <minizip/mz_os.h>
+#include <minizip/mz_strm.h>
+#include <minizip/mz_zip.h>
+#include <minizip/mz_zip_rw.h>
+
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// Loads info.json of a folder of large generated zip mods, the way fa_ModManager::load_mod_info does.
+// Cold loads open every archive anew (central directory included), warm loads reuse the archives kept open by fa_ZipCache.
+// Either way only the central directory and info.json are read, so the times should not grow with the size of the archives.
+// Then reads every small (deflated) and large (stored) file of the mods out of the mapped archives.
+// The OS file cache is not dropped, run it once after a reboot for disk-cold numbers.
+
+struct bench_result
+{
+	double best_ms = 0;
+	double median_ms = 0;
+};
+
+static bench_result measure(size_t repeats, const std::function<void()>& body)
+{
+	std::vector<double> times;
+
+	for (size_t i = 0; i < repeats; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		auto stop = std::chrono::steady_clock::now();
+
+		times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	return { times.front(), times[times.size() / 2] };
+}
+
+static void report(const std::string& name, size_t mods, const bench_result& result)
+{
+	std::cout << std::left << std::setw(40) << name
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << result.best_ms << " ms (best)"
+		<< std::setw(12) << result.median_ms << " ms (median)"
+		<< std::setw(12) << std::setprecision(1) << result.median_ms * 1000.0 / mods << " us/mod" << std::endl;
+}
+
+static bool add_entry(void* writer, const std::string& name, const std::string& data, uint16_t method)
+{
+	mz_zip_file file_info = {};
+
+	file_info.filename = name.c_str();
+	file_info.modified_date = std::time(0);
+	file_info.version_madeby = MZ_VERSION_MADEBY;
+	file_info.compression_method = method;
+	file_info.uncompressed_size = data.size();
+
+	return mz_zip_writer_add_buffer(writer, (void*)data.data(), (int32_t)data.size(), &file_info) == MZ_OK;
+}
+
+// Half of the mods keep their files in a folder named like the archive, as when a mod folder is zipped as a whole
+static bool generate_mod(const std::filesystem::path& path, size_t index, size_t payload_mb, std::mt19937_64& random)
+{
+	std::string stem = path.stem().string();
+	std::string root = index % 2 ? stem + "/" : "";
+
+	std::string info = "{\n\t\"name\": \"mod" + std::to_string(index) + "\",\n\t\"title\": \"Generated zip mod\",\n"
+		"\t\"version\": \"1.0.0\",\n\t\"factastra_version\": \"0.0\",\n\t\"description\": \"" + std::string(200, 'd') + "\"\n}\n";
+
+	void* writer = 0;
+	mz_zip_writer_create(&writer);
+
+	if (mz_zip_writer_open_file(writer, path.u8string().c_str(), 0, 0) != MZ_OK)
+	{
+		mz_zip_writer_delete(&writer);
+		return false;
+	}
+
+	bool ok = true;
+
+	// Assets first, so that info.json is not at the start of the archive
+	std::string asset(1024 * 1024, 0);
+
+	for (size_t i = 0; i < payload_mb && ok; i++)
+	{
+		for (auto& c : asset)
+			c = (char)random();
+
+		ok = add_entry(writer, root + "graphics/asset" + std::to_string(i) + ".png", asset, MZ_COMPRESS_METHOD_STORE);
+	}
+
+	for (size_t i = 0; i < 200 && ok; i++)
+		ok = add_entry(writer, root + "scripts/script" + std::to_string(i) + ".lua", std::string(2000, 's'), MZ_COMPRESS_METHOD_DEFLATE);
+
+	ok = ok && add_entry(writer, root + "info.json", info, MZ_COMPRESS_METHOD_DEFLATE);
+
+	mz_zip_writer_close(writer);
+	mz_zip_writer_delete(&writer);
+
+	return ok;
+}
+
+// Same lookup as load_mod_info
+static bool load_info(fa_ZipCache& cache, const std::filesystem::path& path, size_t& sink)
+{
+	auto archive = cache.open(path);
+	std::string code;
+
+	if (!archive || (!archive->read("info.json", code) && !archive->read(path.stem().string() + "/info.json", code)))
+		return false;
+
+	fa_json info;
+	fa_json_error err;
+	info.parse(code, &err);
+
+	if (err.code != fa_json_errno::ok)
+		return false;
+
+	sink += std::get<fa_json::string>(std::get<fa_json::object>(info).at("name")).size();
+
+	return true;
+}
+
+// fa_zip_bench [<mod count> [<MB per mod> [<repeats>]]]
+int main(int argc, const char** argv)
+{
+	size_t mod_count = argc > 1 ? std::stoul(argv[1]) : 64;
+	size_t payload_mb = argc > 2 ? std::stoul(argv[2]) : 16;
+	size_t repeats = argc > 3 ? std::stoul(argv[3]) : 15;
+
+	auto directory = std::filesystem::temp_directory_path() / "fa_zip_bench";
+	std::filesystem::create_directories(directory);
+
+	std::vector<std::filesystem::path> mods;
+	std::mt19937_64 random(1);
+	uintmax_t archive_bytes = 0;
+
+	for (size_t i = 0; i < mod_count; i++)
+	{
+		auto path = directory / ("mod" + std::to_string(i) + "_1.0.0.zip");
+
+		if (!generate_mod(path, i, payload_mb, random))
+		{
+			std::cerr << "Could not write " << path << std::endl;
+			return 1;
+		}
+
+		archive_bytes += std::filesystem::file_size(path);
+		mods.push_back(path);
+	}
+
+	std::cout << "zip mods: " << mods.size() << " archives, " << archive_bytes / (1024 * 1024) << " MB" << std::endl << std::endl;
+
+	size_t sink = 0;
+	bool ok = true;
+
+	report("info.json cold (open + read)", mods.size(), measure(repeats, [&]() {
+		fa_ZipCache cache;
+
+		for (const auto& path : mods)
+			ok = load_info(cache, path, sink) && ok;
+		}));
+
+	fa_ZipCache cache;
+
+	for (const auto& path : mods)
+		cache.open(path);
+
+	report("info.json warm (cached archives)", mods.size(), measure(repeats, [&]() {
+		for (const auto& path : mods)
+			ok = load_info(cache, path, sink) && ok;
+		}));
+
+	report("open only (central directory)", mods.size(), measure(repeats, [&]() {
+		fa_ZipCache cold;
+
+		for (const auto& path : mods)
+			sink += cold.open(path) != 0;
+		}));
+
+	report("read scripts (deflate)", mods.size(), measure(repeats, [&]() {
+		std::string out;
+
+		for (const auto& path : mods)
+		{
+			auto archive = cache.open(path);
+
+			for (const auto& e : archive->entries())
+			{
+				if (e.name.find("scripts/") != std::string::npos)
+					ok = archive->read(e, out) && ok;
+
+				sink += out.size();
+			}
+		}
+		}));
+
+	report("view assets (stored, zero-copy)", mods.size(), measure(repeats, [&]() {
+		for (const auto& path : mods)
+		{
+			auto archive = cache.open(path);
+
+			for (const auto& e : archive->entries())
+			{
+				if (e.name.find("graphics/") != std::string::npos)
+				{
+					std::string_view data = archive->view(e);
+
+					ok = data.size() == e.size && ok;
+					sink += data.empty() ? 0 : (unsigned char)data[data.size() / 2];
+				}
+			}
+		}
+		}));
+
+	std::filesystem::remove_all(directory);
+
+	if (!ok)
+	{
+		std::cerr << "Some info.json files could not be read" << std::endl;
+		return 1;
+	}
+
+	std::cout << std::endl << "checksum: " << sink << std::endl;
+
+	return 0;
+}
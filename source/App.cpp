@@ -1,17 +1,32 @@
 #include "App.hpp"
 #include "util.hpp"
+#include "Trace.hpp"
 
 #include <iostream>
-#include <functional>
-#include <regex>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
 
-fa_App::fa_App()
+fa_App::fa_App(const std::filesystem::path& appdata_root)
+	: log(logger)
 {
-	appdata_fs = sp::FileSystem(true);
+	FA_TRACE_SCOPE("Create app");
+
+	// The game's own log keeps every line, a burst waits for the writer instead
+	logger.set_overflow(fa_LogOverflow::block);
+
+	if (appdata_root.empty())
+	{
+		appdata_fs = sp::FileSystem(true);
+
+		appdata_fs.createDirIfNecessary("DragonGames");
+		appdata_fs.createDirIfNecessary("DragonGames/FactAstra");
+		appdata_fs.enterDir("DragonGames/FactAstra");
+	}
+	else
+		appdata_fs.enterDir(std::filesystem::absolute(appdata_root));
 
-	appdata_fs.createDirIfNecessary("DragonGames");
-	appdata_fs.createDirIfNecessary("DragonGames/FactAstra");
-	appdata_fs.enterDir("DragonGames/FactAstra");
 	appdata_fs.createDirIfNecessary("mods");
 
 	// __local__ is directory the executable is run from
@@ -31,6 +46,8 @@ fa_App::fa_App()
 
 	startup_options = {
 		{ "l", appdata_fs.getCorrectPath("log.log").string() },
+		{ "trace", "" },
+		{ "exec", "" },
 	};
 
 	modmanager.register_fs(&local_fs);
@@ -50,7 +67,10 @@ void fa_App::run(const std::vector<std::string>& args)
 			arguments.push_back(*it);
 		}
 
-		parse_arguments(arguments, startup_options, startup_flags, unparsed);
+		{
+			FA_TRACE_SCOPE("Parse arguments");
+			parse_arguments(arguments, startup_options, startup_flags, unparsed);
+		}
 
 		if (!unparsed.empty())
 			std::cerr << "Unexpected argument: " << unparsed[0] << std::endl;
@@ -66,11 +86,11 @@ void fa_App::run(const std::vector<std::string>& args)
 
 		if (!local_fs.isDirectory(log_path))
 		{
-			log = local_fs.openOfile(log_path);
+			logger.open(local_fs.openOfile(log_path));
 		}
 		else
 		{
-			log = local_fs.openOfile(log_path / "log.log");
+			logger.open(local_fs.openOfile(log_path / "log.log"));
 		}
 	}
 	else
@@ -80,7 +100,7 @@ void fa_App::run(const std::vector<std::string>& args)
 		startup_flags.at("savemanager") = true;
 		startup_flags.at("window") = true;
 
-		log = local_fs.openOfile(startup_options.at("l"));
+		logger.open(local_fs.openOfile(startup_options.at("l")));
 	}
 
 	// Log success message
@@ -98,38 +118,116 @@ void fa_App::run(const std::vector<std::string>& args)
 
 	log << std::endl;
 
-	if (appdata_fs.isRegularFile("mods/configuration.json"))
 	{
-		if (modmanager.load_configuration("__appdata__/mods/configuration.json", log).code != fa_errno::ok)
-			return;
+		FA_TRACE_SCOPE("Load mods");
+
+		if (appdata_fs.isRegularFile("mods/configuration.json"))
+		{
+			if (modmanager.load_configuration("__appdata__/mods/configuration.json", log).code != fa_errno::ok)
+				return;
+		}
+		else
+		{
+			if (modmanager.add_mod_directory("__appdata__/mods/", log).code != fa_errno::ok)
+				return;
+			//modmanager.add_mod_directory("__root__/data/");
+		}
+
+		// Next launch reuses the metadata of unchanged mods
+		if (!modmanager.is_synchronized())
+			modmanager.synchronize();
 	}
-	else
+
+	reload_mods();
+
+	bool interactive = startup_flags.at("console") || startup_flags.at("modmanager") || startup_flags.at("savemanager");
+	const std::string& script = startup_options.at("exec");
+
+	// Scripts can use every module
+	if (!script.empty())
 	{
-		if (modmanager.add_mod_directory("__appdata__/mods/", log).code != fa_errno::ok)
-			return;
-		//modmanager.add_mod_directory("__root__/data/");
+		startup_flags.at("modmanager") = true;
+		startup_flags.at("savemanager") = true;
+	}
+
+	register_commands();
+
+	if (!script.empty() && !run_script(script))
+	{
+		exit_code = 1;
+		return;
 	}
 
 	// Console executed AT THE END!
-	if (startup_flags.at("console") || startup_flags.at("modmanager") || startup_flags.at("savemanager"))
+	if (interactive)
 	{
-		console_thread = std::thread(&fa_App::console, this);
+		console_reader.start();
+
+		console();
 	}
 }
 
+int fa_App::get_exit_code() const
+{
+	return exit_code;
+}
+
+const fa_ModGraph& fa_App::get_graph() const
+{
+	return graph;
+}
+
+void fa_App::reload_mods()
+{
+	FA_TRACE_SCOPE("Reload mods");
+
+	vfs.build(modmanager, log);
+	graph.build(modmanager.get_mods(), true);
+
+	for (const auto& problem : graph.get_problems())
+		logger.log(fa_LogLevel::warning, problem.description, { { "mod", graph.get_mod(problem.mod).name } });
+
+	mods_changed = false;
+}
+
+void fa_App::apply_mod_changes()
+{
+	if (mods_changed)
+		reload_mods();
+}
+
 void fa_App::quit()
 {
-	// Save current config
-	modmanager.save_configuration("__appdata__/mods/configuration.json", log);
+	{
+		FA_TRACE_SCOPE("Quit");
+
+		// Save current config
+		modmanager.save_configuration("__appdata__/mods/configuration.json", log);
+
+		if (!modmanager.is_synchronized())
+			modmanager.synchronize();
+
+		log << "Stopping console reader..." << std::endl;
+		console_reader.stop();
+	}
+
+	// Every thread which records spans has finished by now
+	const std::string& trace_path = startup_options.at("trace");
 
-	if (console_thread.joinable())
+	if (!trace_path.empty())
 	{
-		log << "Joining console thread..." << std::endl;
-		console_thread.join();
+		if (fa_Tracer::write(local_fs.getCorrectPath(trace_path)))
+			log << "Trace written to " << local_fs.getCorrectPath(trace_path) << "." << std::endl;
+		else
+			log << "Could not write the trace to " << local_fs.getCorrectPath(trace_path) << "." << std::endl;
+
+#ifndef FA_TRACE
+		log << "The game was built without ENABLE_TRACING, the trace holds no spans." << std::endl;
+#endif
 	}
 
-	log << "Safely terminating the process.";
-	log.close();
+	log << "Safely terminating the process." << std::endl;
+	logger.close();
 }
 
 void fa_App::parse_arguments(const std::vector<std::string>& args, std::map<std::string, std::string>& options, std::map<std::string, bool>& flags, std::vector<std::string>& unparsed) const
@@ -164,7 +262,9 @@ void fa_App::parse_arguments(const std::vector<std::string>& args, std::map<std:
 						option_it->second = *it;
 					else
 					{
+						// Missing value, and nothing after it
 						unparsed.push_back(arg);
+						break;
 					}
 				}
 				else
@@ -176,113 +276,403 @@ void fa_App::parse_arguments(const std::vector<std::string>& args, std::map<std:
 	}
 }
 
-void fa_App::console()
+void fa_App::register_commands()
 {
-	std::string command;
-	std::vector<std::string> args;
-	bool running = true;
-
 	bool modmanager_enabled = startup_flags.at("modmanager");
 	bool savemanager_enabled = startup_flags.at("savemanager");
-	bool console_enabled = startup_flags.at("console");
 
-	std::map<std::string, std::map<std::string, std::function<void(const std::vector<std::string>&)>>> commands;
+	commands.clear();
+
+	command list;
+	list.options = { { "t", "all" }, { "r", ".+" }, { "f", "all" } };
+	list.run = &fa_App::cmd_modmanager_list;
+
+	command checkvalid;
+	checkvalid.max_arguments = 1;
+	checkvalid.reads_mods = true;
+	checkvalid.run = &fa_App::cmd_modmanager_checkvalid;
+
+	command enable;
+	enable.options = { { "r", ".+" } };
+	enable.max_arguments = 1;
+	enable.run = &fa_App::cmd_modmanager_enable;
+
+	command disable = enable;
+	disable.flags = { { "includebase", false } };
+	disable.run = &fa_App::cmd_modmanager_disable;
+
+	command loadconfig;
+	loadconfig.options = { { "o", "override" } };
+	loadconfig.flags = { { "negate", false } };
+	loadconfig.min_arguments = 1;
+	loadconfig.max_arguments = 1;
+	loadconfig.run = &fa_App::cmd_modmanager_loadconfig;
+	loadconfig.check = &fa_App::check_modmanager_loadconfig;
 
 	// Load requested modules
 	if (modmanager_enabled)
 		commands.insert({ "modmanager", {
-			{ "list", std::bind(&fa_App::cmd_modmanager_list, this, std::placeholders::_1) },
+			{ "list", list },
+			{ "checkvalid", checkvalid },
+			{ "enable", enable },
+			{ "disable", disable },
+			{ "loadconfig", loadconfig },
 		} });
 
 	if (savemanager_enabled)
 		commands.insert({ "savemanager", {
 		} });
+}
+
+void fa_App::console()
+{
+	bool running = true;
+
+	std::cerr << ">>> ";
 
 	while (running)
 	{
-		std::cerr << ">>> ";
-		
-		while (!getline(std::cin, command)) {}
+		fa_ConsoleCommand command;
+
+		while (running && console_reader.pop(command))
+		{
+			parsed_command parsed;
+			std::string error;
+
+			if (!parse_command(command.args, parsed, &error))
+				std::cerr << error << std::endl;
+			else if (parsed.is_quit)
+				running = false;
+			else
+			{
+				run_command(parsed);
 
-		args = fa_util::split(command, " ");
+				// Each command sees the result of the previous one
+				apply_mod_changes();
+			}
+
+			if (running)
+				std::cerr << ">>> ";
+		}
+
+		if (!running)
+			break;
 
-		if (args[0] == "quit")
-			running = false;
-		else if (args.size() > 1)
+		// The input ended without quit
+		if (console_reader.is_finished())
 		{
-			std::string mod = args[0];
-			std::string cmd = args[1];
+			std::cerr << std::endl;
+			break;
+		}
 
-			auto mod_it = commands.find(mod);
+		if (modmanager.resync(log))
+			reload_mods();
 
-			if (mod_it != commands.end())
-			{
-				auto cmd_it = mod_it->second.find(cmd);
+		// Sleeps until the next command or change of a watched mod. Only changed mods waiting for their debounce time need a timeout.
+		auto timeout = std::chrono::milliseconds::max();
+		auto next_resync = modmanager.next_resync();
 
-				if (cmd_it != mod_it->second.end())
-				{
-					std::vector<std::string> arguments;
-					auto arg_it = args.begin();
-					std::advance(arg_it, 2); // Skip first two
+		if (next_resync != fa_ModWatcher::clock::time_point::max())
+			timeout = std::chrono::ceil<std::chrono::milliseconds>(next_resync - fa_ModWatcher::clock::now());
 
-					for (; arg_it != args.end(); arg_it++)
-						arguments.push_back(*arg_it);
+		console_reader.wait(timeout, modmanager.get_watcher_fd());
+	}
 
-					cmd_it->second(arguments);
-				}
-				else
-				{
-					std::cerr << "Command '" << mod << " -> " << cmd << "' not recognized." << std::endl;
-				}
-			}
-			else
-			{
-				std::cerr << "Module '" << mod << "' not recognized." << std::endl;
-			}
+	std::cerr << "Terminating console." << std::endl;
+}
 
+bool fa_App::parse_command(const std::vector<std::string>& words, parsed_command& parsed, std::string* error)
+{
+	parsed = parsed_command();
 
-		}
-		else
+	if (words[0] == "quit")
+	{
+		parsed.is_quit = true;
+		return true;
+	}
+
+	if (words.size() < 2)
+	{
+		*error = "Command '" + words[0] + "' not recognized.";
+		return false;
+	}
+
+	const std::string& mod = words[0];
+	const std::string& cmd = words[1];
+
+	auto mod_it = commands.find(mod);
+
+	if (mod_it == commands.end())
+	{
+		*error = "Module '" + mod + "' not recognized.";
+		return false;
+	}
+
+	auto cmd_it = mod_it->second.find(cmd);
+
+	if (cmd_it == mod_it->second.end())
+	{
+		*error = "Command '" + mod + " -> " + cmd + "' not recognized.";
+		return false;
+	}
+
+	const command& spec = cmd_it->second;
+	command_args& args = parsed.args;
+
+	args.options = spec.options;
+	args.flags = spec.flags;
+
+	// Skip first two
+	parse_arguments(std::vector<std::string>(words.begin() + 2, words.end()), args.options, args.flags, args.unparsed);
+
+	for (const auto& arg : args.unparsed)
+	{
+		if (arg[0] == '-')
 		{
-			std::cerr << "Command '" << args[0] << "' not recognized." << std::endl;
+			*error = "Option '" + arg + "' of command '" + mod + " -> " + cmd + "' is not known or has no value.";
+			return false;
 		}
 	}
 
-	std::cerr << "Terminating console." << std::endl;
+	if (args.unparsed.size() < spec.min_arguments || args.unparsed.size() > spec.max_arguments)
+	{
+		*error = "Command '" + mod + " -> " + cmd + "' takes " + std::to_string(spec.min_arguments)
+			+ (spec.max_arguments != spec.min_arguments ? " to " + std::to_string(spec.max_arguments) : "")
+			+ " arguments besides options, got " + std::to_string(args.unparsed.size()) + ".";
+		return false;
+	}
+
+	// Compiled once here, the same pattern in other commands comes from the cache
+	auto pattern = args.options.find("r");
+
+	if (pattern != args.options.end())
+	{
+		args.filter = filters.get(pattern->second, error);
+
+		if (!args.filter)
+			return false;
+	}
+
+	if (spec.check && !(this->*spec.check)(args, error))
+		return false;
+
+	parsed.spec = &spec;
+
+	return true;
 }
 
-void fa_App::cmd_modmanager_list(const std::vector<std::string>& args)
+void fa_App::run_command(const parsed_command& parsed)
 {
-	std::map<std::string, std::string> options = {
-		{"t", "all"},
-		{"r", ".+"},
-		{"f", "all"}
-	};
+	if (parsed.spec->reads_mods)
+		apply_mod_changes();
+
+	(this->*parsed.spec->run)(parsed.args);
+}
+
+bool fa_App::run_script(const std::string& path)
+{
+	std::string text;
+
+	if (path == "-")
+		text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+	else
+	{
+		std::ifstream file(local_fs.getCorrectPath(path), std::ios::binary);
+
+		if (!file)
+		{
+			std::cerr << "Could not open the script " << local_fs.getCorrectPath(path) << "." << std::endl;
+			return false;
+		}
+
+		text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	std::vector<parsed_command> script;
+	size_t errors = 0;
+	size_t line_number = 0;
+
+	{
+		FA_TRACE_SCOPE_DETAIL("Parse script", path);
+
+		for (const auto& line : fa_util::split(text, "\n"))
+		{
+			line_number++;
 
-	std::map<std::string, bool> flags;
-	std::vector<std::string> unparsed;
+			fa_ConsoleCommand command = fa_ConsoleCommand::parse(line);
 
-	parse_arguments(args, options, flags, unparsed);
+			if (command.args.empty() || command.args[0][0] == '#')
+				continue;
 
-	std::string t_option = options.at("t");
+			parsed_command parsed;
+			std::string error;
+
+			if (!parse_command(command.args, parsed, &error))
+			{
+				std::cerr << (path == "-" ? "<stdin>" : path) << ":" << line_number << ": " << error << std::endl;
+				errors++;
+				continue;
+			}
+
+			script.push_back(std::move(parsed));
+		}
+	}
+
+	if (errors)
+	{
+		std::cerr << errors << " commands of the script are not valid, none was run." << std::endl;
+		return false;
+	}
+
+	log << "Running " << script.size() << " commands from " << (path == "-" ? "the standard input" : path) << "." << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+
+	{
+		FA_TRACE_SCOPE_DETAIL("Run script", path);
+
+		for (const auto& parsed : script)
+		{
+			if (parsed.is_quit)
+				break;
+
+			run_command(parsed);
+		}
+
+		// Changes of all the commands are rebuilt once
+		apply_mod_changes();
+	}
+
+	log << "Ran the script in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms." << std::endl;
+
+	return true;
+}
+
+void fa_App::cmd_modmanager_list(const command_args& args)
+{
+	std::string t_option = args.options.at("t");
 	bool includes_dir = t_option != "zip";
 	bool includes_zip = t_option != "dir";
 
-	std::string f_option = options.at("f");
+	std::string f_option = args.options.at("f");
 	bool includes_enabled = f_option != "disabled";
 	bool includes_disabled = f_option != "enabled";
 
-	std::regex pattern(options.at("r"));
-
-	for (const auto& [name, mod] : modmanager.get_mods())
+	for (const fa_Mod* mod : args.filter->select(modmanager.get_mods()))
 	{
 		if (
-			((mod.is_zip && includes_zip) || (!mod.is_zip && includes_dir)) &&
-			((mod.enabled && includes_enabled) || (!mod.enabled && includes_disabled)) &&
-			std::regex_match(name, pattern)
+			((mod->is_zip && includes_zip) || (!mod->is_zip && includes_dir)) &&
+			((mod->enabled && includes_enabled) || (!mod->enabled && includes_disabled))
 			)
 		{
-			std::cout << std::endl << "Name: " << name << std::endl << "Title: " << mod.title << std::endl << "Version: " << mod.version.dump() << std::endl;
+			std::cout << std::endl << "Name: " << mod->name << std::endl << "Title: " << mod->title << std::endl << "Version: " << mod->version.dump() << std::endl;
 		}
 	}
 }
+
+void fa_App::cmd_modmanager_enable(const command_args& args)
+{
+	set_mods_enabled(args, true);
+}
+
+void fa_App::cmd_modmanager_disable(const command_args& args)
+{
+	set_mods_enabled(args, false);
+}
+
+void fa_App::set_mods_enabled(const command_args& args, bool enabled)
+{
+	std::vector<const fa_Mod*> selected;
+
+	if (!args.unparsed.empty())
+	{
+		const fa_Mod* mod = modmanager.find_mod(args.unparsed[0]);
+
+		if (!mod)
+		{
+			std::cout << "Mod \"" << args.unparsed[0] << "\" is not loaded." << std::endl;
+			return;
+		}
+
+		selected.push_back(mod);
+	}
+	else
+	{
+		selected = args.filter->select(modmanager.get_mods());
+
+		// Only disabled when named or with --includebase
+		if (!enabled && !args.flags.at("includebase"))
+			selected.erase(std::remove_if(selected.begin(), selected.end(), [](const fa_Mod* mod) { return mod->name == "base"; }), selected.end());
+	}
+
+	size_t changed = 0;
+
+	for (const fa_Mod* mod : selected)
+	{
+		if (mod->enabled != enabled)
+		{
+			modmanager.set_enabled(mod->name, enabled);
+			changed++;
+		}
+	}
+
+	std::cout << (enabled ? "Enabled " : "Disabled ") << changed << " mods." << std::endl;
+
+	if (changed)
+		mods_changed = true;
+}
+
+void fa_App::cmd_modmanager_checkvalid(const command_args& args)
+{
+	std::vector<const fa_ModGraph::problem*> problems;
+
+	if (args.unparsed.empty())
+	{
+		for (const auto& problem : graph.get_problems())
+			problems.push_back(&problem);
+	}
+	else
+	{
+		uint32_t node = graph.find(args.unparsed[0]);
+
+		if (node == fa_ModGraph::none)
+		{
+			std::cout << "Mod \"" << args.unparsed[0] << "\" is not loaded or not enabled." << std::endl;
+			return;
+		}
+
+		problems = graph.get_problems(node);
+	}
+
+	for (const auto* problem : problems)
+		std::cout << "Mod \"" << graph.get_mod(problem->mod).name << "\": " << problem->description << std::endl;
+
+	if (problems.empty())
+		std::cout << "All dependencies are satisfied." << std::endl;
+}
+
+void fa_App::cmd_modmanager_loadconfig(const command_args& args)
+{
+	fa_ModConfig::merge_operator op;
+	fa_ModConfig::parse_operator(args.options.at("o"), &op);
+
+	fa_Error error = modmanager.load_configuration(args.unparsed[0], log, op, args.flags.at("negate"));
+
+	if (error.code != fa_errno::ok)
+		std::cout << error.description << std::endl;
+
+	mods_changed = true;
+}
+
+bool fa_App::check_modmanager_loadconfig(const command_args& args, std::string* error) const
+{
+	fa_ModConfig::merge_operator op;
+
+	if (!fa_ModConfig::parse_operator(args.options.at("o"), &op))
+	{
+		*error = "Unknown merge operator \"" + args.options.at("o") + "\", one of or, and, xor, nor, nand, xnor and override expected.";
+		return false;
+	}
+
+	return true;
+}
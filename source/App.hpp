@@ -1,36 +1,135 @@
 #pragma once
 #include "ModManager.hpp"
+#include "ModVFS.hpp"
+#include "ModGraph.hpp"
+#include "ModFilter.hpp"
+#include "Logger.hpp"
+#include "Console.hpp"
 
 #include <Spectre2D/FileSystem.h>
 
-#include <thread>
+#include <memory>
 
 class fa_App
 {
 public:
-	fa_App();
+	// Appdata (configuration, mod index, mods folder, log) is the game's folder in the user's appdata, or the given folder.
+	// The benchmark mode runs the app in a generated folder this way.
+	explicit fa_App(const std::filesystem::path& appdata_root = std::filesystem::path());
 
 	void run(const std::vector<std::string>& args);
 
 	void quit();
 
+	// 1 when a script given by -exec was not valid
+	int get_exit_code() const;
+
+	// Of the mods loaded by run
+	const fa_ModGraph& get_graph() const;
+
 private:
+	// Options, flags and the rest of the arguments of a command, parsed with the defaults of its spec
+	struct command_args
+	{
+		std::map<std::string, std::string> options;
+		std::map<std::string, bool> flags;
+		std::vector<std::string> unparsed;
+
+		// Compiled pattern of the -r option, for commands which have it
+		std::shared_ptr<const fa_ModFilter> filter;
+	};
+
+	struct command
+	{
+		// Accepted options and flags with their defaults
+		std::map<std::string, std::string> options;
+		std::map<std::string, bool> flags;
+
+		// Number of arguments which are not options or flags
+		size_t min_arguments = 0;
+		size_t max_arguments = 0;
+
+		// Reads the VFS or the dependency graph, so they are rebuilt first if the mods changed
+		bool reads_mods = false;
+
+		void (fa_App::*run)(const command_args& args) = 0;
+
+		// Checks the option values, returns false and sets error if one is not valid
+		bool (fa_App::*check)(const command_args& args, std::string* error) const = 0;
+	};
+
+	// A command line checked against its spec, ready to run
+	struct parsed_command
+	{
+		const command* spec = 0;
+		command_args args;
+		bool is_quit = false;
+	};
+
 	std::map<std::string, std::string> startup_options;
 	std::map<std::string, bool> startup_flags;
 
 	sp::FileSystem appdata_fs;
 	sp::FileSystem local_fs;
 
-	std::ofstream log;
+	// Written by a background thread, log is the stream the rest of the app writes lines into
+	fa_Logger logger;
+	fa_LogStream log;
+
+	// Commands are read on the reader's thread but run on the main thread, between applying changed mods
+	fa_ConsoleReader console_reader;
+
+	// Commands by module and name, of the modules enabled by the startup flags
+	std::map<std::string, std::map<std::string, command>> commands;
 
-	std::thread console_thread;
+	// Commands changed the mods and the VFS and graph were not rebuilt yet
+	bool mods_changed = false;
+
+	int exit_code = 0;
 
 	fa_ModManager modmanager;
 
+	// Files of the enabled mods, rebuilt whenever the loaded mods change
+	fa_ModVFS vfs;
+
+	// Dependencies of the enabled mods, rebuilt along with the VFS
+	fa_ModGraph graph;
+
+	// Patterns of the -r options, kept compiled between commands
+	fa_ModFilterCache filters;
+
 	void parse_arguments(const std::vector<std::string>& args, std::map<std::string, std::string>& options, std::map<std::string, bool>& flags, std::vector<std::string>& unparsed) const;
 
+	// Rebuilds the VFS and the dependency graph after the loaded mods changed
+	void reload_mods();
+
+	// Rebuilds them if commands changed the mods since
+	void apply_mod_changes();
+
+	void register_commands();
+
+	// Runs the queued console commands and applies changes of the watched mods until the console is closed.
+	// Sleeps while there is nothing to do.
 	void console();
 
+	// Finds the command and parses and checks its arguments, compiling its filter. Returns false and sets error if they are not valid.
+	bool parse_command(const std::vector<std::string>& words, parsed_command& parsed, std::string* error);
+
+	void run_command(const parsed_command& parsed);
+
+	// Reads all the commands of the file (or of the standard input for "-"), one per line, with # starting comment lines.
+	// All of them are checked before the first one runs, none runs if any is not valid. Commands after quit are not run.
+	bool run_script(const std::string& path);
+
 	// Console commands
-	void cmd_modmanager_list(const std::vector<std::string>& args);
+	void cmd_modmanager_list(const command_args& args);
+	void cmd_modmanager_checkvalid(const command_args& args);
+	void cmd_modmanager_enable(const command_args& args);
+	void cmd_modmanager_disable(const command_args& args);
+	void cmd_modmanager_loadconfig(const command_args& args);
+
+	bool check_modmanager_loadconfig(const command_args& args, std::string* error) const;
+
+	// Enables or disables the mod given by name or path, or else all mods matching the -r option
+	void set_mods_enabled(const command_args& args, bool enabled);
 };
\ No newline at end of file
@@ -0,0 +1,691 @@
+#include "AppBenchmark.hpp"
+#include "App.hpp"
+#include "Version.hpp"
+#include "json.hpp"
+#include "json_scan.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef FA_COUNT_ALLOCATIONS
+
+// Counted for the benchmark mode, only in builds made for it (the COUNT_ALLOCATIONS CMake option), as every allocation pays for it
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> allocation_bytes(0);
+
+static void count_allocation(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void* allocate_aligned(std::size_t size, std::align_val_t alignment)
+{
+	count_allocation(size);
+
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, (size_t)alignment);
+#else
+	void* p = 0;
+
+	return posix_memalign(&p, std::max((size_t)alignment, sizeof(void*)), size ? size : 1) == 0 ? p : 0;
+#endif
+}
+
+static void free_aligned(void* p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+	count_allocation(size);
+
+	void* p = std::malloc(size ? size : 1);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	count_allocation(size);
+
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* p = allocate_aligned(size, alignment);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	free_aligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	free_aligned(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	free_aligned(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+	free_aligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	free_aligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	free_aligned(p);
+}
+
+bool fa_AppBenchmark::counts_allocations()
+{
+	return true;
+}
+
+size_t fa_AppBenchmark::allocation_count()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+size_t fa_AppBenchmark::allocated_bytes()
+{
+	return allocation_bytes.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool fa_AppBenchmark::counts_allocations()
+{
+	return false;
+}
+
+size_t fa_AppBenchmark::allocation_count()
+{
+	return 0;
+}
+
+size_t fa_AppBenchmark::allocated_bytes()
+{
+	return 0;
+}
+
+#endif
+
+const std::vector<fa_BenchmarkScenario>& fa_AppBenchmark::get_scenarios()
+{
+	static const std::vector<fa_BenchmarkScenario> scenarios = {
+		// name, description, directory, zip, invalid, additional, ignored, configuration entries, depth, configuration, cold
+		{ "first-launch", "Directory and zip mods without a configuration or index", 500, 500, 0, 0, 0, 0, 0, false, true },
+		{ "directories", "Directory mods with a configuration", 1000, 0, 0, 0, 0, 0, 0, true, false },
+		{ "zips", "Zip mods with a configuration", 0, 1000, 0, 0, 0, 0, 0, true, false },
+		{ "mixed", "Directory, zip, additional and invalid mods with a configuration", 500, 500, 100, 50, 0, 0, 0, true, false },
+		{ "cold", "Same as mixed, with the mod index removed before every run", 500, 500, 100, 50, 0, 0, 0, true, true },
+		{ "invalid", "Mostly invalid mods", 100, 100, 2000, 0, 0, 0, 0, true, false },
+		{ "configuration", "A configuration of many mods that do not exist and deeply nested data", 500, 0, 0, 0, 0, 20000, 200, true, false },
+		{ "ignored", "Half of the mods ignored by the configuration", 1000, 0, 0, 0, 500, 0, 0, true, false },
+	};
+
+	return scenarios;
+}
+
+const fa_BenchmarkScenario* fa_AppBenchmark::find_scenario(const std::string& name)
+{
+	for (const auto& scenario : get_scenarios())
+	{
+		if (name == scenario.name)
+			return &scenario;
+	}
+
+	return 0;
+}
+
+static void put_u16(std::string& out, uint16_t value)
+{
+	out += (char)(value & 0xff);
+	out += (char)(value >> 8);
+}
+
+static void put_u32(std::string& out, uint32_t value)
+{
+	put_u16(out, (uint16_t)(value & 0xffff));
+	put_u16(out, (uint16_t)(value >> 16));
+}
+
+// Writes a zip archive of stored entries
+static bool write_zip(const std::filesystem::path& path, const std::vector<std::pair<std::string, std::string>>& files)
+{
+	std::string data;
+	std::string directory;
+
+	for (const auto& [name, contents] : files)
+	{
+		uint32_t crc = (uint32_t)crc32(0, (const Bytef*)contents.data(), (uInt)contents.size());
+		uint32_t offset = (uint32_t)data.size();
+
+		// Local header
+		put_u32(data, 0x04034b50);
+		put_u16(data, 20);
+		put_u16(data, 0);
+		put_u16(data, 0);
+		put_u32(data, 0);
+		put_u32(data, crc);
+		put_u32(data, (uint32_t)contents.size());
+		put_u32(data, (uint32_t)contents.size());
+		put_u16(data, (uint16_t)name.size());
+		put_u16(data, 0);
+		data += name;
+		data += contents;
+
+		// Central directory header
+		put_u32(directory, 0x02014b50);
+		put_u16(directory, 20);
+		put_u16(directory, 20);
+		put_u16(directory, 0);
+		put_u16(directory, 0);
+		put_u32(directory, 0);
+		put_u32(directory, crc);
+		put_u32(directory, (uint32_t)contents.size());
+		put_u32(directory, (uint32_t)contents.size());
+		put_u16(directory, (uint16_t)name.size());
+		put_u16(directory, 0);
+		put_u16(directory, 0);
+		put_u16(directory, 0);
+		put_u16(directory, 0);
+		put_u32(directory, 0);
+		put_u32(directory, offset);
+		directory += name;
+	}
+
+	uint32_t directory_offset = (uint32_t)data.size();
+	data += directory;
+
+	// End of central directory
+	put_u32(data, 0x06054b50);
+	put_u16(data, 0);
+	put_u16(data, 0);
+	put_u16(data, (uint16_t)files.size());
+	put_u16(data, (uint16_t)files.size());
+	put_u32(data, (uint32_t)directory.size());
+	put_u32(data, directory_offset);
+	put_u16(data, 0);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	return (bool)file.write(data.data(), data.size());
+}
+
+static bool write_file(const std::filesystem::path& path, const std::string& contents)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	return (bool)file.write(contents.data(), contents.size());
+}
+
+static std::string info_json(const std::string& name, const std::string& version, const fa_json::arr& dependencies)
+{
+	fa_json info = fa_json::object{
+		{ "name", name },
+		{ "title", "Generated mod " + name },
+		{ "version", version },
+		{ "factastra_version", factastra_version.dump() },
+		{ "description", std::string(120, 'd') },
+		{ "dependencies", dependencies },
+	};
+
+	return info.dump(true);
+}
+
+// Same files in every mod, so that building the VFS has something to index
+static std::vector<std::pair<std::string, std::string>> mod_files(const std::string& info, const std::string& root)
+{
+	return {
+		{ root + "info.json", info },
+		{ root + "scripts/control.lua", std::string(2000, 's') },
+		{ root + "scripts/data.lua", std::string(500, 's') },
+		{ root + "graphics/icon.png", std::string(4000, 'g') },
+		{ root + "locale/en.cfg", std::string(300, 'l') },
+	};
+}
+
+static std::string directory_mod_name(size_t i)
+{
+	return "dmod" + std::to_string(i);
+}
+
+static std::string zip_mod_name(size_t i)
+{
+	return "zmod" + std::to_string(i);
+}
+
+bool fa_AppBenchmark::generate(const fa_BenchmarkScenario& scenario, const std::filesystem::path& appdata_root)
+{
+	auto mods = appdata_root / "mods";
+	auto extra = appdata_root / "extra";
+
+	std::error_code ec;
+	std::filesystem::create_directories(mods, ec);
+	std::filesystem::create_directories(extra, ec);
+
+	if (ec)
+		return false;
+
+	// Chains of up to eight required dependencies, some optional ones across the two kinds.
+	// Every fourth folder has no version in its name, the version then comes from info.json alone.
+	for (size_t i = 0; i < scenario.directory_mods; i++)
+	{
+		fa_json::arr dependencies;
+
+		if (i % 8)
+			dependencies.push_back(directory_mod_name(i - 1) + " >= 1.0");
+
+		if (i % 5 == 0)
+			dependencies.push_back("? " + zip_mod_name(i) + " ~1.0");
+
+		std::string folder = i % 4 == 3 ? directory_mod_name(i) : directory_mod_name(i) + "_1.0." + std::to_string(i % 7);
+
+		for (const auto& [name, contents] : mod_files(info_json(directory_mod_name(i), "1.0." + std::to_string(i % 7), dependencies), ""))
+		{
+			if (!write_file(mods / folder / name, contents))
+				return false;
+		}
+	}
+
+	// Half of the archives keep their files in a folder named like the archive
+	for (size_t i = 0; i < scenario.zip_mods; i++)
+	{
+		fa_json::arr dependencies;
+
+		if (i % 8)
+			dependencies.push_back(zip_mod_name(i - 1) + " >= 1.0");
+
+		std::string stem = zip_mod_name(i) + "_1.0.0";
+
+		if (!write_zip(mods / (stem + ".zip"), mod_files(info_json(zip_mod_name(i), "1.0.0", dependencies), i % 2 ? stem + "/" : "")))
+			return false;
+	}
+
+	for (size_t i = 0; i < scenario.additional_mods; i++)
+	{
+		std::string name = "amod" + std::to_string(i);
+
+		if (!write_zip(extra / (name + "_1.0.0.zip"), mod_files(info_json(name, "1.0.0", {}), "")))
+			return false;
+	}
+
+	for (size_t i = 0; i < scenario.invalid_mods; i++)
+	{
+		std::string number = std::to_string(i);
+		bool ok = true;
+
+		switch (scenario.directory_mods ? i % 4 : i % 3)
+		{
+		case 0:
+			ok = write_file(mods / ("noinfo" + number + "_1.0.0") / "scripts/control.lua", std::string(100, 's'));
+			break;
+
+		case 1:
+			ok = write_file(mods / ("damaged" + number + "_1.0.0.zip"), std::string(1000, 'z'));
+			break;
+
+		case 2:
+			ok = write_file(mods / ("notes" + number + ".txt"), "Not a mod.\n");
+			break;
+
+		default:
+		{
+			// An older version of a mod which is also present
+			std::string name = directory_mod_name(i % scenario.directory_mods);
+			ok = write_file(mods / (name + "_0.9.0") / "info.json", info_json(name, "0.9.0", {}));
+		}
+		}
+
+		if (!ok)
+			return false;
+	}
+
+	if (!scenario.has_configuration)
+		return true;
+
+	fa_json::arr additional;
+	fa_json::arr ignored;
+	fa_json::object configuration;
+
+	for (size_t i = 0; i < scenario.additional_mods; i++)
+		additional.push_back((extra / ("amod" + std::to_string(i) + "_1.0.0.zip")).u8string());
+
+	for (size_t i = 0; i < scenario.ignored_mods; i++)
+		ignored.push_back(i < scenario.directory_mods ? directory_mod_name(i) : zip_mod_name(i - scenario.directory_mods));
+
+	for (size_t i = 0; i < scenario.directory_mods; i++)
+		configuration.insert({ directory_mod_name(i), (fa_json::integer)(i % 3 != 0) });
+
+	for (size_t i = 0; i < scenario.zip_mods; i++)
+		configuration.insert({ zip_mod_name(i), (fa_json::integer)(i % 3 != 0) });
+
+	for (size_t i = 0; i < scenario.configuration_entries; i++)
+		configuration.insert({ "removed" + std::to_string(i), (fa_json::integer)(i % 2) });
+
+	// Data the loader does not read, nested as deep as the parsers allow (an object and an array per level)
+	fa_json history = fa_json::arr{};
+	size_t depth = std::min<size_t>(scenario.configuration_depth, FA_JSON_MAX_DEPTH / 2 - 2);
+
+	for (size_t level = 0; level < depth; level++)
+	{
+		fa_json::arr entries;
+
+		for (size_t i = 0; i < 16; i++)
+			entries.push_back((fa_json::integer)(level * 16 + i));
+
+		history = fa_json::object{
+			{ "level", (fa_json::integer)level },
+			{ "entries", std::move(entries) },
+			{ "previous", fa_json::arr{ std::move(history) } },
+		};
+	}
+
+	fa_json config = fa_json::object{
+		{ "directories", fa_json::arr{ "__appdata__/mods/" } },
+		{ "additional", std::move(additional) },
+		{ "ignored", std::move(ignored) },
+		{ "configuration", std::move(configuration) },
+		{ "history", std::move(history) },
+	};
+
+	// Outside the mods folder, copied in before every run since quitting saves over it
+	return write_file(appdata_root / "configuration.json", config.dump(true));
+}
+
+// Restores the state the scenario starts in
+static void prepare_run(const fa_BenchmarkScenario& scenario, const std::filesystem::path& appdata_root)
+{
+	std::error_code ec;
+	auto mods = appdata_root / "mods";
+
+	if (scenario.has_configuration)
+		std::filesystem::copy_file(appdata_root / "configuration.json", mods / "configuration.json", std::filesystem::copy_options::overwrite_existing, ec);
+	else
+		std::filesystem::remove(mods / "configuration.json", ec);
+
+	if (!scenario.cold)
+		return;
+
+	std::filesystem::remove(mods / "mod_index.fabin", ec);
+}
+
+struct fa_BenchmarkPhase
+{
+	std::vector<double> times;
+	std::vector<size_t> allocations;
+	std::vector<size_t> bytes;
+};
+
+// Nearest rank
+template<typename T>
+static T percentile(std::vector<T> values, double p)
+{
+	std::sort(values.begin(), values.end());
+
+	size_t rank = (size_t)std::max(1.0, std::ceil(p / 100.0 * values.size()));
+
+	return values[std::min(rank, values.size()) - 1];
+}
+
+static fa_json phase_json(const fa_BenchmarkPhase& phase)
+{
+	double sum = 0;
+
+	for (double time : phase.times)
+		sum += time;
+
+	fa_json ret = fa_json::object{
+		{ "min_ms", percentile(phase.times, 0) },
+		{ "p50_ms", percentile(phase.times, 50) },
+		{ "p90_ms", percentile(phase.times, 90) },
+		{ "p99_ms", percentile(phase.times, 99) },
+		{ "max_ms", percentile(phase.times, 100) },
+		{ "mean_ms", sum / phase.times.size() },
+	};
+
+	if (fa_AppBenchmark::counts_allocations())
+	{
+		auto& object = std::get<fa_json::object>(ret);
+
+		object["allocations_p50"] = (fa_json::integer)percentile(phase.allocations, 50);
+		object["allocations_max"] = (fa_json::integer)percentile(phase.allocations, 100);
+		object["allocated_bytes_p50"] = (fa_json::integer)percentile(phase.bytes, 50);
+	}
+
+	return ret;
+}
+
+int fa_AppBenchmark::main(const std::vector<std::string>& args, std::ostream& output, std::ostream& errors)
+{
+	std::string name;
+	size_t runs = 10;
+
+	for (size_t i = 1; i < args.size(); i++)
+	{
+		if (args[i] == "-benchmark" && i + 1 < args.size())
+			name = args[++i];
+		else if (args[i] == "-runs" && i + 1 < args.size())
+			runs = std::max<size_t>(std::strtoul(args[++i].c_str(), 0, 10), 1);
+		else if (args[i] == "-trace" && i + 1 < args.size())
+			i++;
+		else
+		{
+			errors << "Unexpected argument: " << args[i] << std::endl;
+			return 1;
+		}
+	}
+
+	const fa_BenchmarkScenario* scenario = find_scenario(name);
+
+	if (!scenario)
+	{
+		errors << "Unknown benchmark scenario \"" << name << "\". Available scenarios:" << std::endl;
+
+		for (const auto& s : get_scenarios())
+			errors << "  " << s.name << " - " << s.description << std::endl;
+
+		return 1;
+	}
+
+	auto root = std::filesystem::temp_directory_path() / ("fa_benchmark_" + name);
+
+	std::error_code ec;
+	std::filesystem::remove_all(root, ec);
+
+	if (!generate(*scenario, root))
+	{
+		errors << "Could not generate the scenario in " << root << "." << std::endl;
+		std::filesystem::remove_all(root, ec);
+		return 1;
+	}
+
+	// Warm scenarios get one run which writes the mod index first, as the previous launch would have
+	size_t warmup_runs = scenario->cold ? 0 : 1;
+
+	fa_BenchmarkPhase create, run, quit, total;
+
+	// After the last startup. Configurations disable some mods on purpose, so the count is compared between builds, not with 0.
+	size_t problems = 0;
+
+	// Without the console flags nothing waits for input
+	std::vector<std::string> app_args = { args[0], "-l", (root / "log.log").u8string() };
+
+	for (size_t i = 0; i < warmup_runs + runs; i++)
+	{
+		prepare_run(*scenario, root);
+
+		using clock = std::chrono::steady_clock;
+
+		auto start = clock::now();
+		size_t start_allocations = allocation_count(), start_bytes = allocated_bytes();
+		clock::time_point created, started;
+		size_t created_allocations, created_bytes, started_allocations, started_bytes;
+
+		{
+			fa_App app(root);
+
+			created = clock::now();
+			created_allocations = allocation_count();
+			created_bytes = allocated_bytes();
+
+			app.run(app_args);
+
+			started = clock::now();
+			started_allocations = allocation_count();
+			started_bytes = allocated_bytes();
+
+			problems = app.get_graph().get_problems().size();
+
+			app.quit();
+		}
+
+		auto stop = clock::now();
+		size_t stop_allocations = allocation_count(), stop_bytes = allocated_bytes();
+
+		if (i < warmup_runs)
+			continue;
+
+		auto add = [](fa_BenchmarkPhase& phase, clock::time_point from, clock::time_point to, size_t from_allocations, size_t to_allocations, size_t from_bytes, size_t to_bytes) {
+			phase.times.push_back(std::chrono::duration<double, std::milli>(to - from).count());
+			phase.allocations.push_back(to_allocations - from_allocations);
+			phase.bytes.push_back(to_bytes - from_bytes);
+		};
+
+		add(create, start, created, start_allocations, created_allocations, start_bytes, created_bytes);
+		add(run, created, started, created_allocations, started_allocations, created_bytes, started_bytes);
+		add(quit, started, stop, started_allocations, stop_allocations, started_bytes, stop_bytes);
+		add(total, start, stop, start_allocations, stop_allocations, start_bytes, stop_bytes);
+	}
+
+	fa_json report = fa_json::object{
+		{ "scenario", scenario->name },
+		{ "description", scenario->description },
+		{ "factastra_version", factastra_version.dump() },
+		{ "runs", (fa_json::integer)runs },
+		{ "warmup_runs", (fa_json::integer)warmup_runs },
+		{ "mods", fa_json::object{
+			{ "directory", (fa_json::integer)scenario->directory_mods },
+			{ "zip", (fa_json::integer)scenario->zip_mods },
+			{ "invalid", (fa_json::integer)scenario->invalid_mods },
+			{ "additional", (fa_json::integer)scenario->additional_mods },
+			{ "ignored", (fa_json::integer)scenario->ignored_mods },
+		} },
+		{ "configuration", fa_json::object{
+			{ "present", (fa_json::integer)scenario->has_configuration },
+			{ "extra_entries", (fa_json::integer)scenario->configuration_entries },
+			{ "depth", (fa_json::integer)scenario->configuration_depth },
+		} },
+		{ "cold", (fa_json::integer)scenario->cold },
+		{ "dependency_problems", (fa_json::integer)problems },
+		{ "allocations_counted", (fa_json::integer)counts_allocations() },
+		// "quit" includes destroying the app
+		{ "phases", fa_json::object{
+			{ "create", phase_json(create) },
+			{ "run", phase_json(run) },
+			{ "quit", phase_json(quit) },
+			{ "total", phase_json(total) },
+		} },
+	};
+
+	report.dump(output, true);
+	output << std::endl;
+
+	std::filesystem::remove_all(root, ec);
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A generated appdata folder the app is started in
+struct fa_BenchmarkScenario
+{
+	const char* name;
+	const char* description;
+
+	size_t directory_mods;
+	size_t zip_mods;
+
+	// Folders without info.json, damaged archives, stray files and older duplicates, none of which stop the loading
+	size_t invalid_mods;
+
+	// Zip mods outside the mods folder, listed under "additional"
+	size_t additional_mods;
+
+	// Mods listed under "ignored"
+	size_t ignored_mods;
+
+	// Entries of "configuration" for mods which do not exist, and how deep the unused data next to them is nested
+	size_t configuration_entries;
+	size_t configuration_depth;
+
+	// Without a configuration.json the mods folder is scanned as on the first launch
+	bool has_configuration;
+
+	// Removes the mod index before every run, so that every mod is read from its source
+	bool cold;
+};
+
+// Runs the whole startup and shutdown of fa_App (run() and quit(), without the console) in a generated scenario,
+// several times, and prints the time (and in builds which count them, the number of allocations) of each phase as JSON.
+// Everything happens in a temporary folder, the user's appdata is not touched and no window is opened.
+class fa_AppBenchmark
+{
+public:
+	static const std::vector<fa_BenchmarkScenario>& get_scenarios();
+
+	// 0 if there is no such scenario
+	static const fa_BenchmarkScenario* find_scenario(const std::string& name);
+
+	// FactAstra -benchmark <scenario> [-runs <count>], returns the exit code
+	static int main(const std::vector<std::string>& args, std::ostream& output, std::ostream& errors);
+
+	// Writes the mods and the configuration of the scenario into the folder
+	static bool generate(const fa_BenchmarkScenario& scenario, const std::filesystem::path& appdata_root);
+
+	// Whether operator new is replaced to count allocations, only in builds with FA_COUNT_ALLOCATIONS (the COUNT_ALLOCATIONS CMake option)
+	static bool counts_allocations();
+
+	// Allocations made with operator new since the program started, by any thread. Always 0 when they are not counted.
+	static size_t allocation_count();
+	static size_t allocated_bytes();
+};
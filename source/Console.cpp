@@ -0,0 +1,289 @@
+#include "Console.hpp"
+#include "Trace.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+fa_ConsoleCommand fa_ConsoleCommand::parse(std::string line)
+{
+	if (!line.empty() && line.back() == '\r')
+		line.pop_back();
+
+	fa_ConsoleCommand command;
+
+	for (auto& word : fa_util::split(line, " "))
+	{
+		if (!word.empty())
+			command.args.push_back(std::move(word));
+	}
+
+	return command;
+}
+
+fa_CommandQueue::fa_CommandQueue(size_t capacity)
+	: head(0), tail(0)
+{
+	size_t size = 2;
+
+	while (size < capacity)
+		size *= 2;
+
+	slots = std::make_unique<fa_ConsoleCommand[]>(size);
+	mask = size - 1;
+}
+
+bool fa_CommandQueue::push(fa_ConsoleCommand& command)
+{
+	size_t position = tail.load(std::memory_order_relaxed);
+
+	if (position - head.load(std::memory_order_acquire) > mask)
+		return false;
+
+	slots[position & mask] = std::move(command);
+	tail.store(position + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool fa_CommandQueue::pop(fa_ConsoleCommand& command)
+{
+	size_t position = head.load(std::memory_order_relaxed);
+
+	if (position == tail.load(std::memory_order_acquire))
+		return false;
+
+	command = std::move(slots[position & mask]);
+	slots[position & mask].args.clear();
+	head.store(position + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool fa_CommandQueue::empty() const
+{
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+fa_ConsoleReader::fa_ConsoleReader()
+	: finished(true), stopping(false), stop_pipe{ -1, -1 }, wake_pipe{ -1, -1 }
+{
+}
+
+fa_ConsoleReader::~fa_ConsoleReader()
+{
+	stop();
+}
+
+void fa_ConsoleReader::start()
+{
+	stop();
+
+	finished = false;
+	stopping = false;
+
+#ifdef __linux__
+	if (pipe2(stop_pipe, O_CLOEXEC) != 0)
+		stop_pipe[0] = stop_pipe[1] = -1;
+
+	// Never blocks the reader, a full pipe wakes the consumer up all the same
+	if (pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0)
+		wake_pipe[0] = wake_pipe[1] = -1;
+#endif
+
+	reader = std::thread(&fa_ConsoleReader::read_loop, this);
+}
+
+void fa_ConsoleReader::stop()
+{
+	if (!reader.joinable())
+		return;
+
+	stopping = true;
+
+#ifdef __linux__
+	if (stop_pipe[1] != -1)
+	{
+		char c = 0;
+		while (write(stop_pipe[1], &c, 1) < 0 && errno == EINTR) {}
+	}
+#endif
+
+	reader.join();
+
+#ifdef __linux__
+	for (int* pipe : { stop_pipe, wake_pipe })
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (pipe[i] != -1)
+				close(pipe[i]);
+
+			pipe[i] = -1;
+		}
+	}
+#endif
+}
+
+bool fa_ConsoleReader::pop(fa_ConsoleCommand& command)
+{
+	return queue.pop(command);
+}
+
+void fa_ConsoleReader::wait(std::chrono::milliseconds timeout, int fd)
+{
+#ifdef __linux__
+	if (wake_pipe[0] != -1)
+	{
+		// A command queued after this check has already written into the pipe, so poll() returns at once
+		if (!queue.empty() || finished)
+			return;
+
+		pollfd fds[2] = { { wake_pipe[0], POLLIN, 0 }, { fd, POLLIN, 0 } };
+		int poll_timeout = timeout.count() < INT_MAX ? (int)std::max<int64_t>(timeout.count(), 0) : -1;
+
+		while (poll(fds, fd != -1 ? 2 : 1, poll_timeout) < 0 && errno == EINTR) {}
+
+		char buffer[64];
+		while (read(wake_pipe[0], buffer, sizeof(buffer)) > 0) {}
+
+		return;
+	}
+#endif
+
+	std::unique_lock<std::mutex> lock(wake_mutex);
+	auto ready = [this]() {
+		return !queue.empty() || finished;
+	};
+
+	if (timeout == std::chrono::milliseconds::max())
+		wake.wait(lock, ready);
+	else
+		wake.wait_for(lock, timeout, ready);
+}
+
+void fa_ConsoleReader::notify()
+{
+#ifdef __linux__
+	if (wake_pipe[1] != -1)
+	{
+		char c = 0;
+		while (write(wake_pipe[1], &c, 1) < 0 && errno == EINTR) {}
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+	}
+
+	wake.notify_one();
+}
+
+bool fa_ConsoleReader::is_finished() const
+{
+	return finished && queue.empty();
+}
+
+bool fa_ConsoleReader::add_line(std::string line)
+{
+	fa_ConsoleCommand command = fa_ConsoleCommand::parse(std::move(line));
+
+	if (command.args.empty())
+		return true;
+
+	bool is_quit = command.args[0] == "quit";
+
+	// Only full when a long paste outruns the game loop, which drains the queue every tick
+	while (!queue.push(command))
+	{
+		if (stopping)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	notify();
+
+	return !is_quit;
+}
+
+void fa_ConsoleReader::read_loop()
+{
+	FA_TRACE_THREAD("Console");
+
+#ifdef __linux__
+	std::string pending;
+	char buffer[4096];
+	bool reading = true;
+
+	while (reading && !stopping)
+	{
+		pollfd fds[2] = { { STDIN_FILENO, POLLIN, 0 }, { stop_pipe[0], POLLIN, 0 } };
+
+		if (poll(fds, stop_pipe[0] != -1 ? 2 : 1, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		if (fds[1].revents)
+			break;
+
+		if (!fds[0].revents)
+			continue;
+
+		ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+
+		if (count < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+
+			break;
+		}
+
+		// End of the input, the last line may not have a line break
+		if (count == 0)
+		{
+			if (!pending.empty())
+				add_line(pending);
+
+			break;
+		}
+
+		pending.append(buffer, (size_t)count);
+
+		size_t start = 0;
+
+		for (size_t end; reading && (end = pending.find('\n', start)) != std::string::npos; start = end + 1)
+			reading = add_line(pending.substr(start, end - start));
+
+		pending.erase(0, start);
+	}
+#else
+	std::string line;
+
+	while (!stopping && std::getline(std::cin, line))
+	{
+		if (!add_line(line))
+			break;
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		finished = true;
+	}
+
+	notify();
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A console line split into words
+struct fa_ConsoleCommand
+{
+	std::vector<std::string> args;
+
+	// Words are separated by spaces, a line of nothing else gives no words
+	static fa_ConsoleCommand parse(std::string line);
+};
+
+// Fixed ring of commands passed from one producer thread to one consumer thread without locking
+class fa_CommandQueue
+{
+public:
+	// Capacity is rounded up to a power of two
+	explicit fa_CommandQueue(size_t capacity = 256);
+	fa_CommandQueue(const fa_CommandQueue&) = delete;
+
+	fa_CommandQueue& operator=(const fa_CommandQueue&) = delete;
+
+	// Producer only. Returns false if the queue is full, the command is left as it was.
+	bool push(fa_ConsoleCommand& command);
+
+	// Consumer only. Returns false if the queue is empty.
+	bool pop(fa_ConsoleCommand& command);
+
+	bool empty() const;
+
+private:
+	std::unique_ptr<fa_ConsoleCommand[]> slots;
+	size_t mask;
+
+	// Next slot to read, only written by the consumer
+	alignas(64) std::atomic<size_t> head;
+
+	// Next slot to fill, only written by the producer
+	alignas(64) std::atomic<size_t> tail;
+};
+
+// Reads console commands on a thread of its own and queues them for the game loop, which runs them at a point where
+// nothing else uses the state they change.
+// On Linux the reader sleeps in poll() on stdin and a pipe stop() writes into, elsewhere in a blocking read of std::cin.
+// It stops on its own after a "quit" line or at the end of the input, so an input closed early does not keep it spinning.
+// The game loop sleeps in wait(), on Linux in poll() on a pipe the reader writes into after every command, so that it can
+// also wake up for another descriptor (e.g. the mod watcher's). Elsewhere it waits on a condition variable.
+class fa_ConsoleReader
+{
+public:
+	fa_ConsoleReader();
+	fa_ConsoleReader(const fa_ConsoleReader&) = delete;
+	~fa_ConsoleReader();
+
+	fa_ConsoleReader& operator=(const fa_ConsoleReader&) = delete;
+
+	void start();
+
+	// Stops reading and joins the reader. Lines not read yet are left in the input.
+	// Without poll() the reader can only stop by itself, so elsewhere this waits for "quit" or the end of the input.
+	void stop();
+
+	// Takes the next command without blocking
+	bool pop(fa_ConsoleCommand& command);
+
+	// Sleeps until a command is queued, the reader stops, the timeout passes (never with milliseconds::max())
+	// or, on Linux, the descriptor becomes readable
+	void wait(std::chrono::milliseconds timeout, int fd = -1);
+
+	// The reader stopped and every command it read was taken
+	bool is_finished() const;
+
+private:
+	fa_CommandQueue queue;
+
+	std::thread reader;
+	std::atomic<bool> finished;
+	std::atomic<bool> stopping;
+
+	// Only for waking the consumer up, the queue itself is not locked
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+
+	// Written to by stop() to wake the reader from poll(), -1 when not open
+	int stop_pipe[2];
+
+	// Written to by the reader to wake the consumer from poll(), -1 when not open
+	int wake_pipe[2];
+
+	// Wakes the consumer up after a command was queued or the reader stopped
+	void notify();
+
+	void read_loop();
+
+	// Queues the words of the line, returns false once the reader should stop
+	bool add_line(std::string line);
+};
@@ -0,0 +1,213 @@
+#include "FileBuffer.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+fa_FileBuffer::fa_FileBuffer()
+	: data(0), size(0), mapping(0)
+{
+}
+
+fa_FileBuffer::fa_FileBuffer(fa_FileBuffer&& other) noexcept
+	: data(other.data), size(other.size), buffer(std::move(other.buffer)), mapping(other.mapping)
+{
+	other.data = 0;
+	other.size = 0;
+	other.mapping = 0;
+}
+
+fa_FileBuffer::~fa_FileBuffer()
+{
+	close();
+}
+
+fa_FileBuffer& fa_FileBuffer::operator=(fa_FileBuffer&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+
+		data = other.data;
+		size = other.size;
+		buffer = std::move(other.buffer);
+		mapping = other.mapping;
+
+		other.data = 0;
+		other.size = 0;
+		other.mapping = 0;
+	}
+
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool fa_FileBuffer::open(const std::filesystem::path& path, bool sequential)
+{
+	close();
+
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size;
+
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	size = (size_t)file_size.QuadPart;
+
+	bool success = true;
+
+	if (size < map_threshold)
+	{
+		buffer.reset(new char[size + 1]);
+		DWORD read = 0;
+
+		success = !size || (ReadFile(file, buffer.get(), (DWORD)size, &read, 0) && read == size);
+		data = buffer.get();
+	}
+	else
+	{
+		// The mapping keeps the file open on its own
+		HANDLE file_mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+
+		if (file_mapping)
+		{
+			data = (const char*)MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+
+			if (data)
+				mapping = file_mapping;
+			else
+				CloseHandle(file_mapping);
+		}
+
+		success = data != 0;
+	}
+
+	CloseHandle(file);
+
+	if (!success)
+		close();
+
+	return success;
+}
+
+void fa_FileBuffer::close()
+{
+	if (mapping)
+	{
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+	}
+
+	buffer.reset();
+	data = 0;
+	size = 0;
+	mapping = 0;
+}
+
+#else
+
+bool fa_FileBuffer::open(const std::filesystem::path& path, bool sequential)
+{
+	close();
+
+	int file = ::open(path.c_str(), O_RDONLY);
+
+	if (file < 0)
+		return false;
+
+	struct stat info;
+
+	if (fstat(file, &info) || !S_ISREG(info.st_mode))
+	{
+		::close(file);
+		return false;
+	}
+
+	size = (size_t)info.st_size;
+
+	bool success = true;
+
+	if (size < map_threshold)
+	{
+		buffer.reset(new char[size + 1]);
+		data = buffer.get();
+
+		// A single read is enough for regular files, the loop only handles interrupted calls
+		size_t done = 0;
+
+		while (done < size)
+		{
+			ssize_t result = read(file, buffer.get() + done, size - done);
+
+			if (result <= 0)
+			{
+				success = false;
+				break;
+			}
+
+			done += result;
+		}
+	}
+	else
+	{
+		void* mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (mapped != MAP_FAILED)
+		{
+			// Parsers read the file once from the start to the end
+			if (sequential)
+				madvise(mapped, size, MADV_SEQUENTIAL);
+
+			data = (const char*)mapped;
+			mapping = mapped;
+		}
+		else
+			success = false;
+	}
+
+	// The mapping stays valid after closing the descriptor
+	::close(file);
+
+	if (!success)
+		close();
+
+	return success;
+}
+
+void fa_FileBuffer::close()
+{
+	if (mapping)
+		munmap(mapping, size);
+
+	buffer.reset();
+	data = 0;
+	size = 0;
+	mapping = 0;
+}
+
+#endif
+
+std::string_view fa_FileBuffer::view() const
+{
+	return std::string_view(data, size);
+}
+
+bool fa_FileBuffer::is_mapped() const
+{
+	return mapping != 0;
+}
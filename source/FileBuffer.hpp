@@ -0,0 +1,38 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+#include <memory>
+
+// Read-only contents of a whole file.
+// Large files are memory mapped, so parsing runs straight over the mapped pages. Small ones are read with a single call into a buffer of the exact size.
+class fa_FileBuffer
+{
+public:
+	// Files smaller than this are read instead of mapped, as mapping costs more than copying them
+	static constexpr size_t map_threshold = 64 * 1024;
+
+	fa_FileBuffer();
+	fa_FileBuffer(const fa_FileBuffer&) = delete;
+	fa_FileBuffer(fa_FileBuffer&& other) noexcept;
+	~fa_FileBuffer();
+
+	fa_FileBuffer& operator=(const fa_FileBuffer&) = delete;
+	fa_FileBuffer& operator=(fa_FileBuffer&& other) noexcept;
+
+	// Returns false if the file could not be opened or read.
+	// Files which are not read from the start to the end (e.g. archives) should be opened as not sequential.
+	bool open(const std::filesystem::path& path, bool sequential = true);
+	void close();
+
+	std::string_view view() const;
+	bool is_mapped() const;
+
+private:
+	const char* data;
+	size_t size;
+
+	std::unique_ptr<char[]> buffer;
+
+	// Platform handle of the mapping, 0 when the file is not mapped
+	void* mapping;
+};
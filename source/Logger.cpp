@@ -0,0 +1,351 @@
+#include "Logger.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+fa_LogField::fa_LogField(std::string_view k, std::string_view v)
+	: key(k), value(v)
+{
+}
+
+fa_LogField::fa_LogField(std::string_view k, const char* v)
+	: key(k), value(v)
+{
+}
+
+fa_LogField::fa_LogField(std::string_view k, int64_t v)
+	: key(k), value(std::to_string(v))
+{
+}
+
+fa_LogField::fa_LogField(std::string_view k, uint64_t v)
+	: key(k), value(std::to_string(v))
+{
+}
+
+fa_LogField::fa_LogField(std::string_view k, int v)
+	: key(k), value(std::to_string(v))
+{
+}
+
+fa_LogField::fa_LogField(std::string_view k, double v)
+	: key(k), value(std::to_string(v))
+{
+}
+
+static const char* level_prefix(fa_LogLevel level)
+{
+	// Info lines are written as they are, the way the log always looked
+	static const char* const prefixes[] = { "Debug: ", "", "Warning: ", "Error: " };
+
+	return prefixes[(int)level];
+}
+
+fa_Logger::fa_Logger(size_t capacity)
+	: enqueue_position(0), dequeue_position(0), written(0), dropped(0), dropped_total(0),
+	level((int)fa_LogLevel::info), overflow((int)fa_LogOverflow::drop), running(false)
+{
+	size_t size = 2;
+
+	while (size < capacity)
+		size *= 2;
+
+	slots = std::make_unique<slot[]>(size);
+	mask = size - 1;
+
+	// A slot is free for the producer whose position equals its sequence, and ready for the writer at one more
+	for (size_t i = 0; i < size; i++)
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+fa_Logger::~fa_Logger()
+{
+	close();
+}
+
+void fa_Logger::open(std::ofstream _file)
+{
+	close();
+
+	file = std::move(_file);
+	running = true;
+	writer = std::thread(&fa_Logger::write_loop, this);
+}
+
+void fa_Logger::close()
+{
+	if (!writer.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		running = false;
+	}
+
+	wake.notify_one();
+	progress.notify_all();
+	writer.join();
+
+	file.close();
+}
+
+bool fa_Logger::is_open() const
+{
+	return running;
+}
+
+void fa_Logger::set_level(fa_LogLevel _level)
+{
+	level = (int)_level;
+}
+
+fa_LogLevel fa_Logger::get_level() const
+{
+	return (fa_LogLevel)level.load();
+}
+
+void fa_Logger::set_overflow(fa_LogOverflow policy)
+{
+	overflow = (int)policy;
+}
+
+bool fa_Logger::log(fa_LogLevel message_level, std::string_view message)
+{
+	if ((int)message_level < level.load(std::memory_order_relaxed))
+		return false;
+
+	return push(message_level, message);
+}
+
+bool fa_Logger::log(fa_LogLevel message_level, std::string_view message, std::initializer_list<fa_LogField> fields)
+{
+	if ((int)message_level < level.load(std::memory_order_relaxed))
+		return false;
+
+	std::string text(message);
+
+	for (const auto& field : fields)
+	{
+		text += ' ';
+		text += field.key;
+		text += '=';
+
+		// Quoted when it would not read back as one value
+		if (field.value.empty() || field.value.find_first_of(" \t\"=") != std::string::npos)
+		{
+			text += '"';
+
+			for (char c : field.value)
+			{
+				if (c == '"' || c == '\\')
+					text += '\\';
+
+				text += c;
+			}
+
+			text += '"';
+		}
+		else
+			text += field.value;
+	}
+
+	return push(message_level, text);
+}
+
+bool fa_Logger::push(fa_LogLevel message_level, std::string_view text)
+{
+	size_t position = enqueue_position.load(std::memory_order_relaxed);
+	slot* s;
+
+	for (;;)
+	{
+		s = &slots[position & mask];
+
+		size_t sequence = s->sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+		if (difference == 0)
+		{
+			if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			// Full. Waiting only makes sense while the writer is running.
+			bool wait = running && (message_level == fa_LogLevel::error || overflow.load(std::memory_order_relaxed) == (int)fa_LogOverflow::block);
+
+			if (!wait)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				dropped_total.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(wake_mutex);
+
+				wake.notify_one();
+				progress.wait(lock, [this, position]() {
+					return !running || (intptr_t)slots[position & mask].sequence.load(std::memory_order_acquire) - (intptr_t)position >= 0;
+					});
+			}
+
+			position = enqueue_position.load(std::memory_order_relaxed);
+		}
+		else
+			position = enqueue_position.load(std::memory_order_relaxed);
+	}
+
+	// Assigned into the string left in the slot, which keeps its capacity, so steady logging does not allocate
+	s->level = message_level;
+	s->text.assign(text.data(), text.size());
+	s->sequence.store(position + 1, std::memory_order_release);
+
+	// Half full, so the writer should not wait for its timeout
+	if (position - written.load(std::memory_order_relaxed) == mask / 2)
+		wake.notify_one();
+
+	return true;
+}
+
+void fa_Logger::flush()
+{
+	size_t target = enqueue_position.load(std::memory_order_acquire);
+	std::unique_lock<std::mutex> lock(wake_mutex);
+
+	wake.notify_one();
+	progress.wait(lock, [this, target]() {
+		return !running || written.load(std::memory_order_acquire) >= target;
+		});
+}
+
+size_t fa_Logger::dropped_count() const
+{
+	return dropped_total;
+}
+
+size_t fa_Logger::drain(std::string& batch)
+{
+	size_t count = 0;
+
+	for (;;)
+	{
+		slot& s = slots[dequeue_position & mask];
+
+		if (s.sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+			break;
+
+		batch += level_prefix(s.level);
+		batch += s.text;
+		batch += '\n';
+
+		// Cleared but not freed, for the next message in the slot
+		s.text.clear();
+		s.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+
+		dequeue_position++;
+		count++;
+	}
+
+	size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+
+	if (lost)
+		batch += std::string(level_prefix(fa_LogLevel::warning)) + std::to_string(lost) + " log messages were dropped.\n";
+
+	return count;
+}
+
+void fa_Logger::write_loop()
+{
+	std::string batch;
+
+	for (;;)
+	{
+		bool stopping = !running;
+
+		batch.clear();
+		size_t count = drain(batch);
+
+		if (!batch.empty())
+		{
+			file.write(batch.data(), batch.size());
+			file.flush();
+		}
+
+		written.fetch_add(count, std::memory_order_release);
+
+		if (count)
+		{
+			// Under the mutex, so that a waiter checking its condition right now does not miss it
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			progress.notify_all();
+			continue;
+		}
+
+		// Everything logged before close is written by now
+		if (stopping)
+			break;
+
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		wake.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+			return !running || slots[dequeue_position & mask].sequence.load(std::memory_order_acquire) == dequeue_position + 1;
+			});
+	}
+}
+
+fa_LogStream::fa_LogStream(fa_Logger& logger, fa_LogLevel level)
+	: std::ostream(0), line_buffer(logger, level)
+{
+	rdbuf(&line_buffer);
+}
+
+fa_LogStream::~fa_LogStream()
+{
+	line_buffer.finish();
+}
+
+fa_LogStream::buffer::buffer(fa_Logger& _logger, fa_LogLevel _level)
+	: logger(_logger), level(_level)
+{
+}
+
+void fa_LogStream::buffer::finish()
+{
+	if (!line.empty())
+	{
+		logger.log(level, line);
+		line.clear();
+	}
+}
+
+fa_LogStream::buffer::int_type fa_LogStream::buffer::overflow(int_type c)
+{
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	if (traits_type::to_char_type(c) == '\n')
+	{
+		logger.log(level, line);
+		line.clear();
+	}
+	else
+		line += traits_type::to_char_type(c);
+
+	return c;
+}
+
+std::streamsize fa_LogStream::buffer::xsputn(const char* s, std::streamsize n)
+{
+	std::string_view text(s, (size_t)n);
+
+	for (size_t end; (end = text.find('\n')) != std::string_view::npos; text.remove_prefix(end + 1))
+	{
+		line.append(text.data(), end);
+		logger.log(level, line);
+		line.clear();
+	}
+
+	line.append(text.data(), text.size());
+
+	return n;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <initializer_list>
+
+enum class fa_LogLevel
+{
+	debug,
+	info,
+	warning,
+	error
+};
+
+// What happens to a message when the queue is full
+enum class fa_LogOverflow
+{
+	// The message is dropped and counted, the writer reports how many were lost
+	drop,
+
+	// The caller waits for the writer to make room
+	block
+};
+
+// A key=value pair appended to a message
+struct fa_LogField
+{
+	std::string_view key;
+	std::string value;
+
+	fa_LogField(std::string_view k, std::string_view v);
+	fa_LogField(std::string_view k, const char* v);
+	fa_LogField(std::string_view k, int64_t v);
+	fa_LogField(std::string_view k, uint64_t v);
+	fa_LogField(std::string_view k, int v);
+	fa_LogField(std::string_view k, double v);
+};
+
+// Log file written by a background thread.
+// Messages go into a fixed ring of slots which any number of threads fill without locking. The writer takes all the
+// waiting ones at once and writes them with a single write and flush, so logging a line costs no system call.
+// Memory stays bounded by the number of slots, what happens when they run out is chosen by the overflow policy.
+// Errors always wait for room rather than being dropped.
+class fa_Logger
+{
+public:
+	static constexpr size_t default_capacity = 4096;
+
+	// Capacity is rounded up to a power of two
+	explicit fa_Logger(size_t capacity = default_capacity);
+	fa_Logger(const fa_Logger&) = delete;
+	~fa_Logger();
+
+	fa_Logger& operator=(const fa_Logger&) = delete;
+
+	// Starts the writer over the file. Messages logged before are kept and written first.
+	void open(std::ofstream file);
+
+	// Writes everything logged so far and stops the writer
+	void close();
+
+	bool is_open() const;
+
+	void set_level(fa_LogLevel level);
+	fa_LogLevel get_level() const;
+
+	void set_overflow(fa_LogOverflow policy);
+
+	// Safe to call from any thread. Returns false if the message was filtered out or dropped.
+	bool log(fa_LogLevel level, std::string_view message);
+	bool log(fa_LogLevel level, std::string_view message, std::initializer_list<fa_LogField> fields);
+
+	// Waits until everything logged so far is written to the file
+	void flush();
+
+	// Messages dropped since the logger was created
+	size_t dropped_count() const;
+
+private:
+	struct slot
+	{
+		std::atomic<size_t> sequence;
+		fa_LogLevel level = fa_LogLevel::info;
+		std::string text;
+	};
+
+	std::unique_ptr<slot[]> slots;
+	size_t mask;
+
+	// Next slot to fill, shared by the producers
+	alignas(64) std::atomic<size_t> enqueue_position;
+
+	// Next slot to write, only touched by the writer
+	alignas(64) size_t dequeue_position;
+
+	// Messages taken out of the ring and written
+	std::atomic<size_t> written;
+
+	std::atomic<size_t> dropped;
+	std::atomic<size_t> dropped_total;
+
+	std::atomic<int> level;
+	std::atomic<int> overflow;
+
+	std::ofstream file;
+	std::thread writer;
+	std::atomic<bool> running;
+
+	// Wakes the writer up early. Logging takes the mutex only while waiting for room, flush while waiting for the writer.
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+
+	// Notified by the writer after every batch it wrote, and when it stops
+	std::condition_variable progress;
+
+	bool push(fa_LogLevel level, std::string_view text);
+
+	void write_loop();
+
+	// Moves waiting messages into the batch, returns how many there were
+	size_t drain(std::string& batch);
+};
+
+// Writes lines into a logger through the std::ostream interface, so code taking a std::ostream& can log into it.
+// Every complete line becomes one message of the stream's level. Flushing (as std::endl does) does not flush the file.
+// A stream keeps the unfinished line, so each thread should use its own stream or lock around writing.
+class fa_LogStream : public std::ostream
+{
+public:
+	explicit fa_LogStream(fa_Logger& logger, fa_LogLevel level = fa_LogLevel::info);
+	~fa_LogStream();
+
+private:
+	class buffer : public std::streambuf
+	{
+	public:
+		buffer(fa_Logger& logger, fa_LogLevel level);
+
+		// Logs the unfinished line, if any
+		void finish();
+
+	protected:
+		int_type overflow(int_type c) override;
+		std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+	private:
+		fa_Logger& logger;
+		fa_LogLevel level;
+		std::string line;
+	};
+
+	buffer line_buffer;
+};
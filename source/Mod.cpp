@@ -0,0 +1,71 @@
+#include "Mod.hpp"
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static bool is_operator(char c)
+{
+	return c == '<' || c == '>' || c == '=' || c == '~' || c == '^';
+}
+
+bool fa_ModDependency::parse(const std::string& declaration)
+{
+	*this = fa_ModDependency();
+
+	size_t i = 0;
+	size_t end = declaration.size();
+
+	auto skip_spaces = [&]() {
+		while (i < end && is_space(declaration[i]))
+			i++;
+	};
+
+	skip_spaces();
+
+	while (end > i && is_space(declaration[end - 1]))
+		end--;
+
+	if (declaration.compare(i, 1, "!") == 0)
+	{
+		type = kind::conflict;
+		i++;
+	}
+	else if (declaration.compare(i, 1, "?") == 0)
+	{
+		type = kind::optional;
+		i++;
+	}
+
+	skip_spaces();
+
+	size_t name_begin = i;
+
+	while (i < end && !is_space(declaration[i]) && !is_operator(declaration[i]))
+		i++;
+
+	name = declaration.substr(name_begin, i - name_begin);
+
+	if (name.empty())
+		return false;
+
+	return constraint.parse(declaration.substr(i, end - i));
+}
+
+std::string fa_ModDependency::dump() const
+{
+	static const char* const prefixes[] = { "", "? ", "! " };
+
+	std::string ret = prefixes[(int)type] + name;
+
+	if (!constraint.allows_any())
+		ret += " " + constraint.dump();
+
+	return ret;
+}
+
+bool fa_ModDependency::allows(const fa_Version& other) const
+{
+	return constraint.allows(other);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "Version.hpp"
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+// One entry of the dependencies array in info.json, e.g. "base >= 0.1", "? other ~1.2" or "! incompatible < 2".
+// Without a prefix the dependency is required, "?" makes it optional and "!" marks a mod that must not be enabled alongside.
+// Anything after the name is a version constraint, see fa_VersionConstraint.
+struct fa_ModDependency
+{
+	enum class kind
+	{
+		required,
+		optional,
+		conflict
+	};
+
+	kind type = kind::required;
+	std::string name;
+
+	// Versions of the other mod the dependency (or conflict) applies to
+	fa_VersionConstraint constraint;
+
+	// Returns false if the declaration is not valid
+	bool parse(const std::string& declaration);
+	std::string dump() const;
+
+	bool allows(const fa_Version& other) const;
+};
+
+struct fa_Mod
+{
+	std::string title;
+	std::string name;
+	std::string description;
+
+	bool is_zip;
+	std::filesystem::path path;
+	std::filesystem::path inner_path;
+	
+	fa_Version version;
+
+	std::vector<fa_ModDependency> dependencies;
+
+	bool enabled;
+};
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "ModConfig.hpp"
+
+#include <algorithm>
+#include <utility>
+
+uint32_t fa_ModIds::add(const std::string& name)
+{
+	auto [it, inserted] = ids.insert({ name, (uint32_t)names.size() });
+
+	if (inserted)
+		names.push_back(name);
+
+	return it->second;
+}
+
+uint32_t fa_ModIds::find(const std::string& name) const
+{
+	auto it = ids.find(name);
+
+	return it == ids.end() ? none : it->second;
+}
+
+const std::string& fa_ModIds::name(uint32_t id) const
+{
+	return names[id];
+}
+
+size_t fa_ModIds::size() const
+{
+	return names.size();
+}
+
+bool fa_ModConfig::parse_operator(const std::string& name, merge_operator* op)
+{
+	static const std::pair<const char*, merge_operator> operators[] = {
+		{ "override", merge_operator::override },
+		{ "or", merge_operator::logical_or },
+		{ "and", merge_operator::logical_and },
+		{ "xor", merge_operator::logical_xor },
+		{ "nor", merge_operator::logical_nor },
+		{ "nand", merge_operator::logical_nand },
+		{ "xnor", merge_operator::logical_xnor },
+	};
+
+	for (const auto& [text, value] : operators)
+	{
+		if (name == text)
+		{
+			*op = value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void fa_ModConfig::set(uint32_t id, bool is_enabled)
+{
+	size_t word = id / 64;
+	uint64_t bit = (uint64_t)1 << (id % 64);
+
+	if (word >= present.size())
+	{
+		present.resize(word + 1, 0);
+		enabled.resize(word + 1, 0);
+	}
+
+	present[word] |= bit;
+
+	if (is_enabled)
+		enabled[word] |= bit;
+	else
+		enabled[word] &= ~bit;
+}
+
+void fa_ModConfig::remove(uint32_t id)
+{
+	size_t word = id / 64;
+	uint64_t bit = (uint64_t)1 << (id % 64);
+
+	if (word < present.size())
+	{
+		present[word] &= ~bit;
+		enabled[word] &= ~bit;
+	}
+}
+
+void fa_ModConfig::clear()
+{
+	present.clear();
+	enabled.clear();
+}
+
+bool fa_ModConfig::is_present(uint32_t id) const
+{
+	return id / 64 < present.size() && (present[id / 64] >> (id % 64) & 1);
+}
+
+bool fa_ModConfig::is_enabled(uint32_t id) const
+{
+	return id / 64 < enabled.size() && (enabled[id / 64] >> (id % 64) & 1);
+}
+
+template<typename Op>
+void fa_ModConfig::merge_words(const fa_ModConfig& loaded, bool negate, Op op)
+{
+	size_t words = std::max(present.size(), loaded.present.size());
+
+	present.resize(words, 0);
+	enabled.resize(words, 0);
+
+	// Flipping every enabled bit of the loaded configuration when negating, kept inside its present bits
+	uint64_t flip = negate ? ~(uint64_t)0 : 0;
+	size_t loaded_words = loaded.present.size();
+
+	// Plain loops over arrays, which compilers turn into vector instructions
+	for (size_t i = 0; i < loaded_words; i++)
+	{
+		uint64_t current_present = present[i];
+		uint64_t current_enabled = enabled[i];
+		uint64_t loaded_present = loaded.present[i];
+		uint64_t loaded_enabled = (loaded.enabled[i] ^ flip) & loaded_present;
+
+		uint64_t both = current_present & loaded_present;
+
+		enabled[i] = (op(current_enabled, loaded_enabled) & both)
+			| (current_enabled & ~loaded_present)
+			| (loaded_enabled & ~current_present);
+
+		present[i] = current_present | loaded_present;
+	}
+}
+
+void fa_ModConfig::merge(const fa_ModConfig& loaded, merge_operator op, bool negate)
+{
+	switch (op)
+	{
+	case merge_operator::override:
+		merge_words(loaded, negate, [](uint64_t, uint64_t other) { return other; });
+		break;
+
+	case merge_operator::logical_or:
+		merge_words(loaded, negate, [](uint64_t current, uint64_t other) { return current | other; });
+		break;
+
+	case merge_operator::logical_and:
+		merge_words(loaded, negate, [](uint64_t current, uint64_t other) { return current & other; });
+		break;
+
+	case merge_operator::logical_xor:
+		merge_words(loaded, negate, [](uint64_t current, uint64_t other) { return current ^ other; });
+		break;
+
+	case merge_operator::logical_nor:
+		merge_words(loaded, negate, [](uint64_t current, uint64_t other) { return ~(current | other); });
+		break;
+
+	case merge_operator::logical_nand:
+		merge_words(loaded, negate, [](uint64_t current, uint64_t other) { return ~(current & other); });
+		break;
+
+	case merge_operator::logical_xnor:
+		merge_words(loaded, negate, [](uint64_t current, uint64_t other) { return ~(current ^ other); });
+		break;
+	}
+}
+
+size_t fa_ModConfig::size() const
+{
+	return present.size();
+}
+
+const std::vector<uint64_t>& fa_ModConfig::get_present() const
+{
+	return present;
+}
+
+const std::vector<uint64_t>& fa_ModConfig::get_enabled() const
+{
+	return enabled;
+}
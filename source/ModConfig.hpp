@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Numbers of mod names, given out on first use and never changed, so that configurations can be kept as bitsets over them
+class fa_ModIds
+{
+public:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	// Numbers the name if it is new
+	uint32_t add(const std::string& name);
+
+	// none if the name was never added
+	uint32_t find(const std::string& name) const;
+
+	const std::string& name(uint32_t id) const;
+	size_t size() const;
+
+private:
+	std::unordered_map<std::string, uint32_t> ids;
+	std::vector<std::string> names;
+};
+
+// Which mods are enabled, as two bitsets over fa_ModIds: whether the configuration mentions the mod and whether it is enabled.
+// Enabled bits are only ever set for mods which are present.
+class fa_ModConfig
+{
+public:
+	// How a loaded configuration is merged into the current one, see modmanager loadconfig in help.md.
+	// Mods present in only one of the configurations keep their state from it.
+	enum class merge_operator
+	{
+		override,
+		logical_or,
+		logical_and,
+		logical_xor,
+		logical_nor,
+		logical_nand,
+		logical_xnor
+	};
+
+	// Names as in help.md, returns false for unknown ones
+	static bool parse_operator(const std::string& name, merge_operator* op);
+
+	void set(uint32_t id, bool enabled);
+	void remove(uint32_t id);
+	void clear();
+
+	bool is_present(uint32_t id) const;
+	bool is_enabled(uint32_t id) const;
+
+	// Merges the loaded configuration into this one. With negate, mods enabled in the loaded one are treated as disabled and vice versa.
+	// Runs over whole 64-bit words, without looking at single mods.
+	void merge(const fa_ModConfig& loaded, merge_operator op, bool negate = false);
+
+	// Bits of ids up to size() * 64
+	size_t size() const;
+	const std::vector<uint64_t>& get_present() const;
+	const std::vector<uint64_t>& get_enabled() const;
+
+private:
+	std::vector<uint64_t> present;
+	std::vector<uint64_t> enabled;
+
+	template<typename Op>
+	void merge_words(const fa_ModConfig& loaded, bool negate, Op op);
+};
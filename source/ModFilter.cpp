@@ -0,0 +1,370 @@
+#include "ModFilter.hpp"
+
+#include <bitset>
+
+// One character class of a simple pattern, with its quantifier ("+" is written as the class followed by the class with "*")
+struct fa_FilterItem
+{
+	std::bitset<256> set;
+	char quantifier = 0;
+};
+
+// Simple patterns are limited by the 64 bits used for sets of DFA states, and the DFA by its table size
+static const size_t max_items = 63;
+static const size_t max_states = 1024;
+
+// "." of ECMAScript matches everything but line terminators
+static std::bitset<256> any_character()
+{
+	std::bitset<256> set;
+	set.set();
+	set.reset('\n');
+	set.reset('\r');
+
+	return set;
+}
+
+static bool is_line_terminator(char c)
+{
+	return c == '\n' || c == '\r';
+}
+
+static bool is_alphanumeric(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Splits the pattern into items, returns false if it uses anything else than characters, escaped punctuation,
+// ".", "[...]" classes without escapes and single "*", "+" and "?" quantifiers
+static bool parse_simple(const std::string& pattern, std::vector<fa_FilterItem>& items)
+{
+	bool quantified = true;
+
+	for (size_t i = 0; i < pattern.size(); i++)
+	{
+		char c = pattern[i];
+		fa_FilterItem item;
+
+		switch (c)
+		{
+		case '*':
+		case '+':
+		case '?':
+			if (quantified)
+				return false;
+
+			if (c == '+')
+			{
+				items.push_back(items.back());
+				c = '*';
+			}
+
+			items.back().quantifier = c;
+			quantified = true;
+			continue;
+
+		case '^':
+		case '$':
+		case '|':
+		case '(':
+		case ')':
+		case '{':
+		case '}':
+		case ']':
+			return false;
+
+		case '\\':
+			if (i + 1 == pattern.size() || is_alphanumeric(pattern[i + 1]))
+				return false;
+
+			item.set.set((uint8_t)pattern[++i]);
+			break;
+
+		case '.':
+			item.set = any_character();
+			break;
+
+		case '[':
+		{
+			size_t j = i + 1;
+			bool negated = j < pattern.size() && pattern[j] == '^';
+
+			if (negated)
+				j++;
+
+			// "[]" and "[^]" mean something else in ECMAScript
+			if (j < pattern.size() && pattern[j] == ']')
+				return false;
+
+			for (; j < pattern.size() && pattern[j] != ']'; j++)
+			{
+				if (pattern[j] == '\\' || pattern[j] == '[')
+					return false;
+
+				if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']')
+				{
+					// Left to std::regex, in "[!-\]]" the "\]" is an escape and not the end of the range
+					if (pattern[j + 2] == '\\' || pattern[j + 2] == '[')
+						return false;
+
+					uint8_t first = pattern[j], last = pattern[j + 2];
+
+					if (first > last)
+						return false;
+
+					for (unsigned int k = first; k <= last; k++)
+						item.set.set(k);
+
+					j += 2;
+				}
+				else
+					item.set.set((uint8_t)pattern[j]);
+			}
+
+			if (j == pattern.size())
+				return false;
+
+			if (negated)
+				item.set.flip();
+
+			i = j;
+			break;
+		}
+
+		default:
+			item.set.set((uint8_t)c);
+		}
+
+		items.push_back(item);
+		quantified = false;
+
+		if (items.size() > max_items)
+			return false;
+	}
+
+	return items.size() <= max_items;
+}
+
+// Adds the positions reachable without reading, by skipping items with "*" or "?"
+static uint64_t closure(const std::vector<fa_FilterItem>& items, uint64_t positions)
+{
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if ((positions >> i & 1) && items[i].quantifier)
+			positions |= (uint64_t)1 << (i + 1);
+	}
+
+	return positions;
+}
+
+bool fa_ModFilter::compile(const std::string& pattern, std::string* error)
+{
+	*this = fa_ModFilter();
+
+	std::vector<fa_FilterItem> items;
+
+	if (parse_simple(pattern, items))
+	{
+		// Literal characters, possibly followed by ".*" or ". .*" (which is what ".+" became)
+		size_t literal_length = 0;
+
+		while (literal_length < items.size() && !items[literal_length].quantifier && items[literal_length].set.count() == 1)
+			literal_length++;
+
+		for (size_t i = 0; i < literal_length; i++)
+		{
+			for (size_t c = 0; c < 256; c++)
+			{
+				if (items[i].set[c])
+					text.push_back((char)c);
+			}
+		}
+
+		auto is_any = [&](size_t i, char quantifier) {
+			return items[i].quantifier == quantifier && items[i].set == any_character();
+		};
+
+		size_t rest = items.size() - literal_length;
+
+		if (rest == 0)
+		{
+			type = kind::literal;
+			return true;
+		}
+
+		if (rest == 1 && is_any(literal_length, '*'))
+		{
+			type = kind::prefix;
+			return true;
+		}
+
+		if (rest == 2 && is_any(literal_length, 0) && is_any(literal_length + 1, '*'))
+		{
+			type = kind::prefix;
+			nonempty_rest = true;
+			return true;
+		}
+
+		text.clear();
+
+		// Subset construction, with sets of positions in the pattern as states
+		std::vector<uint64_t> states = { 0, closure(items, 1) };
+		std::unordered_map<uint64_t, uint32_t> numbers = { { states[0], 0 }, { states[1], 1 } };
+
+		for (size_t state = 0; state < states.size() && states.size() <= max_states; state++)
+		{
+			for (size_t c = 0; c < 256; c++)
+			{
+				uint64_t next = 0;
+
+				for (size_t i = 0; i < items.size(); i++)
+				{
+					if ((states[state] >> i & 1) && items[i].set[c])
+						next |= (uint64_t)1 << (items[i].quantifier == '*' ? i : i + 1);
+				}
+
+				next = closure(items, next);
+
+				auto [it, inserted] = numbers.insert({ next, (uint32_t)states.size() });
+
+				if (inserted)
+					states.push_back(next);
+
+				transitions.push_back(it->second);
+			}
+
+			accepting.push_back(states[state] >> items.size() & 1);
+		}
+
+		if (states.size() <= max_states)
+		{
+			type = kind::dfa;
+			return true;
+		}
+
+		transitions.clear();
+		accepting.clear();
+	}
+
+	try
+	{
+		expression = std::regex(pattern);
+	}
+	catch (const std::regex_error& e)
+	{
+		*error = "Invalid regex \"" + pattern + "\": " + e.what();
+		return false;
+	}
+
+	type = kind::regex;
+	return true;
+}
+
+fa_ModFilter::kind fa_ModFilter::get_kind() const
+{
+	return type;
+}
+
+bool fa_ModFilter::matches(std::string_view name) const
+{
+	switch (type)
+	{
+	case kind::literal:
+		return name == text;
+
+	case kind::prefix:
+		if (name.size() < text.size() + nonempty_rest || name.compare(0, text.size(), text) != 0)
+			return false;
+
+		for (size_t i = text.size(); i < name.size(); i++)
+		{
+			if (is_line_terminator(name[i]))
+				return false;
+		}
+
+		return true;
+
+	case kind::dfa:
+		return matches_dfa(name);
+
+	default:
+		return std::regex_match(name.begin(), name.end(), expression);
+	}
+}
+
+bool fa_ModFilter::matches_dfa(std::string_view name) const
+{
+	uint32_t state = 1;
+
+	for (char c : name)
+	{
+		state = transitions[(size_t)state * 256 + (uint8_t)c];
+
+		if (state == 0)
+			return false;
+	}
+
+	return accepting[state];
+}
+
+std::vector<const fa_Mod*> fa_ModFilter::select(const std::map<std::string, fa_Mod>& mods) const
+{
+	std::vector<const fa_Mod*> selected;
+
+	if (type == kind::literal)
+	{
+		auto it = mods.find(text);
+
+		if (it != mods.end())
+			selected.push_back(&it->second);
+	}
+	else if (type == kind::prefix)
+	{
+		// Names with the prefix are next to each other in the map
+		for (auto it = mods.lower_bound(text); it != mods.end() && it->first.compare(0, text.size(), text) == 0; it++)
+		{
+			if (matches(it->first))
+				selected.push_back(&it->second);
+		}
+	}
+	else
+	{
+		for (const auto& [name, mod] : mods)
+		{
+			if (matches(name))
+				selected.push_back(&mod);
+		}
+	}
+
+	return selected;
+}
+
+std::shared_ptr<const fa_ModFilter> fa_ModFilterCache::get(const std::string& pattern, std::string* error)
+{
+	auto it = filters.find(pattern);
+
+	if (it != filters.end())
+		return it->second;
+
+	auto filter = std::make_shared<fa_ModFilter>();
+
+	if (!filter->compile(pattern, error))
+		return 0;
+
+	if (filters.size() >= capacity)
+		filters.clear();
+
+	filters.insert({ pattern, filter });
+
+	return filter;
+}
+
+void fa_ModFilterCache::clear()
+{
+	filters.clear();
+}
+
+size_t fa_ModFilterCache::size() const
+{
+	return filters.size();
+}
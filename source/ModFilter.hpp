@@ -0,0 +1,72 @@
+#pragma once
+#include "Mod.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <regex>
+#include <cstdint>
+
+// A -r filter of the modmanager commands: an ECMAScript regex which has to match the whole mod name, same as std::regex_match.
+// Patterns are compiled once into the cheapest form which matches the same names:
+// - literals ("base") and prefixes ("base.*", "bob.+") are looked up in the sorted map of mods,
+// - patterns of single characters, ".", "[...]" classes and the "*", "+" and "?" quantifiers become a DFA over bytes,
+// - anything else (groups, alternatives, escapes like "\d", counted repetition) goes to std::regex.
+class fa_ModFilter
+{
+public:
+	enum class kind
+	{
+		literal,
+		prefix,
+		dfa,
+		regex
+	};
+
+	// Returns false and describes the problem if the pattern is not a valid regex
+	bool compile(const std::string& pattern, std::string* error);
+
+	kind get_kind() const;
+	bool matches(std::string_view name) const;
+
+	// Mods whose names match, in name order
+	std::vector<const fa_Mod*> select(const std::map<std::string, fa_Mod>& mods) const;
+
+private:
+	kind type = kind::literal;
+
+	// The literal, or the prefix
+	std::string text;
+
+	// Prefix patterns ending with ".+" need at least one more character
+	bool nonempty_rest = false;
+
+	// Row of 256 transitions for every state. State 0 never accepts and never leaves, state 1 is the start.
+	std::vector<uint32_t> transitions;
+	std::vector<bool> accepting;
+
+	std::regex expression;
+
+	bool compile_dfa(const std::string& pattern);
+	bool matches_dfa(std::string_view name) const;
+};
+
+// Filters compiled so far, so that repeating a command does not compile its pattern again
+class fa_ModFilterCache
+{
+public:
+	// Some patterns are dropped once there are more
+	static constexpr size_t capacity = 64;
+
+	// Null if the pattern is not valid, with the problem described in error
+	std::shared_ptr<const fa_ModFilter> get(const std::string& pattern, std::string* error);
+
+	void clear();
+	size_t size() const;
+
+private:
+	std::unordered_map<std::string, std::shared_ptr<const fa_ModFilter>> filters;
+};
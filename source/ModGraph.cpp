@@ -0,0 +1,350 @@
+#include "ModGraph.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+
+static std::string describe_constraint(const fa_ModDependency& dependency)
+{
+	fa_ModDependency constraint = dependency;
+	constraint.type = fa_ModDependency::kind::required;
+
+	return constraint.dump();
+}
+
+void fa_ModGraph::build(const std::map<std::string, fa_Mod>& all_mods, bool enabled_only)
+{
+	FA_TRACE_SCOPE("Build mod graph");
+	clear();
+
+	for (const auto& [name, mod] : all_mods)
+	{
+		if (!enabled_only || mod.enabled)
+		{
+			ids.insert({ name, (uint32_t)mods.size() });
+			mods.push_back(&mod);
+		}
+	}
+
+	uint32_t count = (uint32_t)mods.size();
+	std::vector<uint32_t> dependent_counts(count, 0);
+
+	// Packed once, so that every edge is checked with one integer comparison
+	std::vector<uint64_t> version_keys(count);
+
+	for (uint32_t node = 0; node < count; node++)
+		version_keys[node] = mods[node]->version.key();
+
+	offsets.reserve(count + 1);
+	offsets.push_back(0);
+
+	for (uint32_t node = 0; node < count; node++)
+	{
+		const auto& dependencies = mods[node]->dependencies;
+
+		for (uint32_t i = 0; i < dependencies.size(); i++)
+		{
+			const fa_ModDependency& dependency = dependencies[i];
+			auto it = ids.find(dependency.name);
+
+			if (dependency.type == fa_ModDependency::kind::conflict)
+			{
+				if (it != ids.end() && dependency.constraint.allows(version_keys[it->second]))
+					problems.push_back({ problem::kind::conflict, node, "Conflicts with mod \"" + dependency.name + "\"." });
+
+				continue;
+			}
+
+			if (it == ids.end())
+			{
+				if (dependency.type == fa_ModDependency::kind::required)
+				{
+					bool disabled = all_mods.count(dependency.name) != 0;
+					problems.push_back({ problem::kind::missing, node, "Requires mod \"" + dependency.name + "\", which is " + (disabled ? "disabled." : "missing.") });
+				}
+
+				continue;
+			}
+
+			uint32_t target = it->second;
+
+			// Still an edge, so that the load order stays right once the versions are fixed
+			if (!dependency.constraint.allows(version_keys[target]))
+				problems.push_back({ problem::kind::version, node, "Requires \"" + describe_constraint(dependency) + "\", but version " + mods[target]->version.dump() + " is present." });
+
+			edges.push_back({ target, dependency.type, i });
+			dependent_counts[target]++;
+		}
+
+		offsets.push_back((uint32_t)edges.size());
+	}
+
+	// Turned around with a counting sort, which keeps the dependents of every mod in order
+	reverse_offsets.resize(count + 1);
+	reverse_offsets[0] = 0;
+
+	for (uint32_t node = 0; node < count; node++)
+		reverse_offsets[node + 1] = reverse_offsets[node] + dependent_counts[node];
+
+	reverse_edges.resize(edges.size());
+
+	std::vector<uint32_t> positions(reverse_offsets.begin(), reverse_offsets.end() - 1);
+
+	for (uint32_t node = 0; node < count; node++)
+	{
+		for (uint32_t i = offsets[node]; i < offsets[node + 1]; i++)
+			reverse_edges[positions[edges[i].target]++] = { node, edges[i].type, edges[i].dependency };
+	}
+
+	find_cycles();
+	find_load_order();
+}
+
+void fa_ModGraph::clear()
+{
+	mods.clear();
+	ids.clear();
+	offsets.clear();
+	edges.clear();
+	reverse_offsets.clear();
+	reverse_edges.clear();
+	load_order.clear();
+	cycles.clear();
+	problems.clear();
+}
+
+size_t fa_ModGraph::size() const
+{
+	return mods.size();
+}
+
+uint32_t fa_ModGraph::find(const std::string& name) const
+{
+	auto it = ids.find(name);
+
+	return it != ids.end() ? it->second : none;
+}
+
+const fa_Mod& fa_ModGraph::get_mod(uint32_t node) const
+{
+	return *mods[node];
+}
+
+const fa_ModGraph::edge* fa_ModGraph::edges_begin(uint32_t node) const
+{
+	return edges.data() + offsets[node];
+}
+
+const fa_ModGraph::edge* fa_ModGraph::edges_end(uint32_t node) const
+{
+	return edges.data() + offsets[node + 1];
+}
+
+const std::vector<uint32_t>& fa_ModGraph::get_load_order() const
+{
+	return load_order;
+}
+
+const std::vector<std::vector<uint32_t>>& fa_ModGraph::get_cycles() const
+{
+	return cycles;
+}
+
+const std::vector<fa_ModGraph::problem>& fa_ModGraph::get_problems() const
+{
+	return problems;
+}
+
+std::vector<const fa_ModGraph::problem*> fa_ModGraph::get_problems(uint32_t node) const
+{
+	std::vector<const problem*> ret;
+
+	for (const auto& p : problems)
+	{
+		if (p.mod == node)
+			ret.push_back(&p);
+	}
+
+	return ret;
+}
+
+std::vector<uint32_t> fa_ModGraph::dependencies(uint32_t node, size_t depth, bool include_optional) const
+{
+	return walk(node, depth, include_optional, offsets, edges);
+}
+
+std::vector<uint32_t> fa_ModGraph::dependents(uint32_t node, size_t depth, bool include_optional) const
+{
+	return walk(node, depth, include_optional, reverse_offsets, reverse_edges);
+}
+
+std::vector<uint32_t> fa_ModGraph::walk(uint32_t node, size_t depth, bool include_optional, const std::vector<uint32_t>& walk_offsets, const std::vector<edge>& walk_edges) const
+{
+	std::vector<uint32_t> ret;
+
+	if (node >= mods.size() || depth == 0)
+		return ret;
+
+	std::vector<bool> seen(mods.size(), false);
+	seen[node] = true;
+
+	auto expand = [&](uint32_t from) {
+		for (uint32_t i = walk_offsets[from]; i < walk_offsets[from + 1]; i++)
+		{
+			const edge& e = walk_edges[i];
+
+			if ((include_optional || e.type != fa_ModDependency::kind::optional) && !seen[e.target])
+			{
+				seen[e.target] = true;
+				ret.push_back(e.target);
+			}
+		}
+	};
+
+	expand(node);
+
+	// Breadth first, ret holds one level after another
+	size_t level_begin = 0;
+
+	for (size_t level = 1; level < depth && level_begin < ret.size(); level++)
+	{
+		size_t level_end = ret.size();
+
+		for (size_t i = level_begin; i < level_end; i++)
+			expand(ret[i]);
+
+		level_begin = level_end;
+	}
+
+	return ret;
+}
+
+void fa_ModGraph::find_load_order()
+{
+	uint32_t count = (uint32_t)mods.size();
+
+	// Dependencies not loaded yet
+	std::vector<uint32_t> waiting(count);
+
+	for (uint32_t node = 0; node < count; node++)
+	{
+		waiting[node] = offsets[node + 1] - offsets[node];
+
+		if (!waiting[node])
+			load_order.push_back(node);
+	}
+
+	// Kahn's algorithm, the order doubles as the queue
+	for (size_t i = 0; i < load_order.size(); i++)
+	{
+		uint32_t node = load_order[i];
+
+		for (uint32_t j = reverse_offsets[node]; j < reverse_offsets[node + 1]; j++)
+		{
+			if (--waiting[reverse_edges[j].target] == 0)
+				load_order.push_back(reverse_edges[j].target);
+		}
+	}
+
+	if (load_order.size() == count)
+		return;
+
+	std::vector<bool> in_cycle(count, false);
+
+	for (const auto& cycle : cycles)
+	{
+		for (uint32_t node : cycle)
+			in_cycle[node] = true;
+	}
+
+	for (uint32_t node = 0; node < count; node++)
+	{
+		if (waiting[node] && !in_cycle[node])
+			problems.push_back({ problem::kind::cycle, node, "Depends on mods in a dependency cycle." });
+	}
+}
+
+void fa_ModGraph::find_cycles()
+{
+	// Tarjan's strongly connected components, without recursion so that long chains of mods do not overflow the stack
+	uint32_t count = (uint32_t)mods.size();
+
+	std::vector<uint32_t> index(count, none);
+	std::vector<uint32_t> low(count, 0);
+	std::vector<bool> on_stack(count, false);
+	std::vector<uint32_t> stack;
+
+	// Node and its next edge to follow
+	std::vector<std::pair<uint32_t, uint32_t>> frames;
+	uint32_t next_index = 0;
+
+	for (uint32_t start = 0; start < count; start++)
+	{
+		if (index[start] != none)
+			continue;
+
+		index[start] = low[start] = next_index++;
+		stack.push_back(start);
+		on_stack[start] = true;
+		frames.push_back({ start, offsets[start] });
+
+		while (!frames.empty())
+		{
+			uint32_t node = frames.back().first;
+
+			if (frames.back().second < offsets[node + 1])
+			{
+				uint32_t target = edges[frames.back().second++].target;
+
+				if (index[target] == none)
+				{
+					index[target] = low[target] = next_index++;
+					stack.push_back(target);
+					on_stack[target] = true;
+					frames.push_back({ target, offsets[target] });
+				}
+				else if (on_stack[target])
+					low[node] = std::min(low[node], index[target]);
+
+				continue;
+			}
+
+			if (low[node] == index[node])
+			{
+				std::vector<uint32_t> component;
+
+				do
+				{
+					component.push_back(stack.back());
+					on_stack[stack.back()] = false;
+					stack.pop_back();
+				} while (component.back() != node);
+
+				bool depends_on_itself = std::any_of(edges_begin(node), edges_end(node), [node](const edge& e) { return e.target == node; });
+
+				if (component.size() > 1 || depends_on_itself)
+				{
+					std::reverse(component.begin(), component.end());
+
+					// Cycles can span thousands of mods, so only the first few are named
+					std::string names;
+
+					for (size_t i = 0; i < component.size() && i < 5; i++)
+						names += (i ? ", \"" : "\"") + mods[component[i]]->name + "\"";
+
+					if (component.size() > 5)
+						names += " and " + std::to_string(component.size() - 5) + " more";
+
+					for (uint32_t member : component)
+						problems.push_back({ problem::kind::cycle, member, "Is in a dependency cycle of mods " + names + "." });
+
+					cycles.push_back(std::move(component));
+				}
+			}
+
+			frames.pop_back();
+
+			if (!frames.empty())
+				low[frames.back().first] = std::min(low[frames.back().first], low[node]);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "Mod.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+
+// Dependencies between a set of mods, with mods numbered from 0 and edges kept in CSR form
+// (the edges of every mod next to each other in one array, found through an array of offsets).
+// The load order, cycles and problems are found when the graph is built, in time linear in the number of mods and dependencies.
+class fa_ModGraph
+{
+public:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	// Depth of queries reaching every mod
+	static constexpr size_t all = SIZE_MAX;
+
+	struct edge
+	{
+		uint32_t target = none;
+		fa_ModDependency::kind type = fa_ModDependency::kind::required;
+
+		// Index into the dependencies of the mod
+		uint32_t dependency = 0;
+	};
+
+	struct problem
+	{
+		enum class kind
+		{
+			missing,
+			version,
+			conflict,
+			cycle
+		};
+
+		kind type = kind::missing;
+		uint32_t mod = none;
+		std::string description;
+	};
+
+	// Mods are numbered in the order of the map. With enabled_only, disabled mods are left out as if they were missing.
+	// The graph points into the mods, which have to stay unchanged while it is used.
+	void build(const std::map<std::string, fa_Mod>& mods, bool enabled_only);
+	void clear();
+
+	size_t size() const;
+
+	// none if the mod is not in the graph
+	uint32_t find(const std::string& name) const;
+	const fa_Mod& get_mod(uint32_t node) const;
+
+	// Required and optional dependencies which are in the graph, conflicts are not edges
+	const edge* edges_begin(uint32_t node) const;
+	const edge* edges_end(uint32_t node) const;
+
+	// Every mod after its dependencies. Mods in or depending on a cycle are left out.
+	const std::vector<uint32_t>& get_load_order() const;
+
+	// Groups of mods which depend on each other in a cycle
+	const std::vector<std::vector<uint32_t>>& get_cycles() const;
+
+	const std::vector<problem>& get_problems() const;
+
+	// Problems of one mod
+	std::vector<const problem*> get_problems(uint32_t node) const;
+
+	// Mods the node depends on (or depending on the node) up to the given depth, where 1 means only direct ones
+	// and all means every one. Closest mods come first. Runs in linear time.
+	std::vector<uint32_t> dependencies(uint32_t node, size_t depth, bool include_optional = true) const;
+	std::vector<uint32_t> dependents(uint32_t node, size_t depth, bool include_optional = true) const;
+
+private:
+	std::vector<const fa_Mod*> mods;
+	std::unordered_map<std::string, uint32_t> ids;
+
+	// Edges of node i are edges[offsets[i]] to edges[offsets[i + 1]]
+	std::vector<uint32_t> offsets;
+	std::vector<edge> edges;
+
+	// The same edges turned around, target being the dependent mod
+	std::vector<uint32_t> reverse_offsets;
+	std::vector<edge> reverse_edges;
+
+	std::vector<uint32_t> load_order;
+	std::vector<std::vector<uint32_t>> cycles;
+	std::vector<problem> problems;
+
+	void find_load_order();
+	void find_cycles();
+
+	std::vector<uint32_t> walk(uint32_t node, size_t depth, bool include_optional, const std::vector<uint32_t>& walk_offsets, const std::vector<edge>& walk_edges) const;
+};
@@ -0,0 +1,256 @@
+#include "ModIndex.hpp"
+#include "FileBuffer.hpp"
+#include "ZipArchive.hpp"
+#include "json_binary.hpp"
+#include "util.hpp"
+
+#include <fstream>
+
+// Bumped whenever the stored fields change
+static const fa_json::integer index_format = 5;
+
+static fa_json::integer get_integer(const fa_json_binary& object, std::string_view key)
+{
+	return object.find(key).get_integer();
+}
+
+static std::string get_string(const fa_json_binary& object, std::string_view key)
+{
+	return std::string(object.find(key).get_string());
+}
+
+static fa_json version_to_json(const fa_Version& version)
+{
+	return fa_json::arr{
+		(fa_json::integer)version.major, (fa_json::integer)version.minor, (fa_json::integer)version.patch,
+		(fa_json::integer)(version.major_parsed | version.minor_parsed << 1 | version.patch_parsed << 2)
+	};
+}
+
+static fa_Version version_from_json(const fa_json_binary& value)
+{
+	fa_Version version((uint32_t)value[0].get_integer(), (uint32_t)value[1].get_integer(), (uint32_t)value[2].get_integer());
+	fa_json::integer parsed = value[3].get_integer();
+
+	version.major_parsed = parsed & 1;
+	version.minor_parsed = parsed & 2;
+	version.patch_parsed = parsed & 4;
+
+	return version;
+}
+
+// Hash of what load_mod_info reads: info.json of directory mods, the central directory of zip mods.
+// Zip entries are not read, their names, sizes and checksums are all in the central directory. 0 if the source can not be read.
+static uint64_t hash_source(const std::filesystem::path& source)
+{
+	if (source.extension() == ".zip")
+	{
+		fa_ZipArchive archive;
+
+		return archive.open(source) ? fa_util::hash(archive.central_directory()) : 0;
+	}
+
+	fa_FileBuffer file;
+
+	return file.open(source) ? fa_util::hash(file.view()) : 0;
+}
+
+void fa_ModIndex::load(const std::filesystem::path& _path)
+{
+	path = _path;
+	entries.clear();
+	seen.clear();
+	stale = true;
+
+	fa_FileBuffer file;
+
+	if (!file.open(path))
+		return;
+
+	fa_json_binary root(file.view().data(), file.view().data() + file.view().size());
+
+	if (get_integer(root, "format") != index_format || get_string(root, "factastra_version") != factastra_version.dump())
+		return;
+
+	fa_json_binary mods = root.find("mods");
+
+	for (size_t i = 0; i < mods.size(); i++)
+	{
+		fa_json_binary value = mods.value(i);
+		entry& e = entries[std::string(mods.key(i))];
+
+		e.source.size = (uint64_t)get_integer(value, "size");
+		e.source.mtime = get_integer(value, "mtime");
+		e.source.hash = (uint64_t)get_integer(value, "hash");
+
+		e.mod.name = get_string(value, "name");
+		e.mod.title = get_string(value, "title");
+		e.mod.description = get_string(value, "description");
+		e.mod.is_zip = get_integer(value, "is_zip");
+		e.mod.path = std::filesystem::u8path(get_string(value, "path"));
+		e.mod.inner_path = std::filesystem::u8path(get_string(value, "inner_path"));
+		e.mod.version = version_from_json(value.find("version"));
+		e.mod.enabled = get_integer(value, "enabled");
+
+		fa_json_binary dependencies = value.find("dependencies");
+		e.mod.dependencies.resize(dependencies.size());
+
+		for (size_t j = 0; j < dependencies.size(); j++)
+			e.mod.dependencies[j].parse(std::string(dependencies[j].get_string()));
+
+		e.error.code = (fa_errno)get_integer(value, "error");
+		e.error.description = get_string(value, "error_description");
+		e.log = get_string(value, "log");
+	}
+
+	stale = false;
+}
+
+bool fa_ModIndex::save()
+{
+	if (!stale || path.empty())
+		return true;
+
+	fa_json::object mods;
+
+	for (const auto& [key, e] : entries)
+	{
+		fa_json::arr dependencies;
+
+		for (const auto& dependency : e.mod.dependencies)
+			dependencies.push_back(dependency.dump());
+
+		mods.insert({ key, fa_json::object{
+			{ "size", (fa_json::integer)e.source.size },
+			{ "mtime", (fa_json::integer)e.source.mtime },
+			{ "hash", (fa_json::integer)e.source.hash },
+			{ "name", e.mod.name },
+			{ "title", e.mod.title },
+			{ "description", e.mod.description },
+			{ "is_zip", (fa_json::integer)e.mod.is_zip },
+			{ "path", e.mod.path.u8string() },
+			{ "inner_path", e.mod.inner_path.u8string() },
+			{ "version", version_to_json(e.mod.version) },
+			{ "enabled", (fa_json::integer)e.mod.enabled },
+			{ "dependencies", std::move(dependencies) },
+			{ "error", (fa_json::integer)e.error.code },
+			{ "error_description", e.error.description },
+			{ "log", e.log },
+		} });
+	}
+
+	fa_json root = fa_json::object{
+		{ "format", index_format },
+		{ "factastra_version", factastra_version.dump() },
+		{ "mods", std::move(mods) },
+	};
+
+	std::string encoded;
+	fa_json_binary_encode(root, encoded);
+
+	// Replaced at once, so that a crash never leaves half of an index behind
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		if (!file.write(encoded.data(), encoded.size()))
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+
+	if (ec)
+	{
+		std::filesystem::remove(temporary, ec);
+		return false;
+	}
+
+	stale = false;
+
+	return true;
+}
+
+const fa_ModIndex::entry* fa_ModIndex::find(const std::filesystem::path& mod_path, stamp* current) const
+{
+	std::filesystem::path source = source_path(mod_path);
+	std::error_code ec;
+
+	*current = stamp();
+	current->size = std::filesystem::file_size(source, ec);
+
+	if (!ec)
+		current->mtime = std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+
+	if (ec)
+		return 0;
+
+	auto it = entries.find(mod_path.u8string());
+
+	if (it == entries.end() || it->second.source.size != current->size)
+		return 0;
+
+	if (it->second.source.mtime == current->mtime)
+	{
+		current->hash = it->second.source.hash;
+		return &it->second;
+	}
+
+	// Touched, but possibly not changed
+	current->hash = hash_source(source);
+
+	return current->hash && current->hash == it->second.source.hash ? &it->second : 0;
+}
+
+void fa_ModIndex::update(const std::filesystem::path& mod_path, entry value)
+{
+	std::string key = mod_path.u8string();
+
+	seen[key] = true;
+
+	// Hashed only now, when the source is new or really changed
+	if (!value.source.hash)
+		value.source.hash = hash_source(source_path(mod_path));
+
+	auto it = entries.find(key);
+
+	if (it != entries.end() && it->second.source.size == value.source.size && it->second.source.mtime == value.source.mtime && it->second.source.hash == value.source.hash)
+		return;
+
+	entries[key] = std::move(value);
+	stale = true;
+}
+
+void fa_ModIndex::prune()
+{
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (seen.count(it->first))
+			it++;
+		else
+		{
+			it = entries.erase(it);
+			stale = true;
+		}
+	}
+}
+
+bool fa_ModIndex::is_stale() const
+{
+	return stale;
+}
+
+size_t fa_ModIndex::size() const
+{
+	return entries.size();
+}
+
+std::filesystem::path fa_ModIndex::source_path(const std::filesystem::path& mod_path)
+{
+	if (mod_path.extension() == ".zip")
+		return mod_path;
+
+	return mod_path / "info.json";
+}
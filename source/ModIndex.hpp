@@ -0,0 +1,66 @@
+#pragma once
+#include "Mod.hpp"
+#include "errors.hpp"
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+// Results of fa_ModManager::load_mod_info kept on disk between launches, keyed by the mod's path.
+// An entry is reused while its source (info.json of directory mods, the archive of zip mods) keeps the same size and
+// modification time, or the same hash when only the time changed. Zip mods hash only their central directory, not the whole archive.
+// The index is dropped when the game version changes.
+class fa_ModIndex
+{
+public:
+	// Size, modification time and hash of a mod's source
+	struct stamp
+	{
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		uint64_t hash = 0;
+	};
+
+	struct entry
+	{
+		stamp source;
+
+		fa_Mod mod;
+		fa_Error error;
+
+		// What load_mod_info logged, replayed when the entry is reused
+		std::string log;
+	};
+
+	// Starts empty if the file is missing, damaged or from another game version
+	void load(const std::filesystem::path& path);
+
+	// Writes the index if it changed since it was loaded or saved
+	bool save();
+
+	// The entry of the mod if its source did not change. Fills in the current stamp of the source either way.
+	// Safe to call from several threads, as long as nothing is updated meanwhile.
+	const entry* find(const std::filesystem::path& mod_path, stamp* current) const;
+
+	void update(const std::filesystem::path& mod_path, entry value);
+
+	// Removes entries of mods which were not found or updated since load
+	void prune();
+
+	// Whether the file on disk differs from the index in memory
+	bool is_stale() const;
+
+	size_t size() const;
+
+	// The file a mod's entry is checked against
+	static std::filesystem::path source_path(const std::filesystem::path& mod_path);
+
+private:
+	std::filesystem::path path;
+	std::unordered_map<std::string, entry> entries;
+
+	// Keys of the entries seen since load, used by prune
+	std::unordered_map<std::string, bool> seen;
+
+	bool stale = false;
+};
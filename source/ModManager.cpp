@@ -1,33 +1,218 @@
 #include "ModManager.hpp"
 #include "json.hpp"
+#include "json_lazy.hpp"
 #include "errors.hpp"
+#include "FileBuffer.hpp"
+#include "ZipArchive.hpp"
+#include "Trace.hpp"
 
-#include <minizip/mz_zip.h>
-#include <minizip/mz_strm_os.h>
-#include <minizip/mz.h>
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
 
-static fa_Error read_string_field(const fa_json::object& obj, const std::string& field, std::string* value)
+
+// Collects the top-level fields of info.json without building the document.
+// Fields are strings or arrays of strings. Parsing stops as soon as all the requested fields were seen.
+class fa_ModInfoHandler : public fa_json_handler
+{
+public:
+	struct field
+	{
+		bool present = false;
+		bool is_string = false;
+		std::string value;
+
+		// Arrays whose elements are all strings
+		bool is_string_array = false;
+		std::vector<std::string> elements;
+	};
+
+	bool is_object = false;
+	std::map<std::string, field> fields;
+
+	fa_ModInfoHandler(std::initializer_list<std::string> names)
+	{
+		for (const auto& name : names)
+			fields.insert({ name, field() });
+
+		remaining = fields.size();
+	}
+
+	bool start_object() override
+	{
+		if (depth == 0)
+			is_object = true;
+		else if (array)
+			array->is_string_array = false;
+		else if (!record(false, ""))
+			return false;
+
+		depth++;
+		return true;
+	}
+
+	bool key(const std::string& key) override
+	{
+		if (depth == 1)
+		{
+			auto it = fields.find(key);
+
+			// Duplicate keys keep the first value, same as fa_json::object
+			current = it != fields.end() && !it->second.present ? &it->second : 0;
+		}
+
+		return true;
+	}
+
+	bool end_object() override
+	{
+		depth--;
+		return true;
+	}
+
+	bool start_array() override
+	{
+		// Main structure is not an object, there is nothing to collect
+		if (depth == 0)
+			return false;
+
+		if (depth == 1 && current)
+		{
+			array = current;
+			array->present = true;
+			array->is_string_array = true;
+			current = 0;
+		}
+		else if (array)
+			array->is_string_array = false;
+		else if (!record(false, ""))
+			return false;
+
+		depth++;
+		return true;
+	}
+
+	bool end_array() override
+	{
+		depth--;
+
+		if (depth == 1 && array)
+		{
+			array = 0;
+			remaining--;
+			return remaining != 0;
+		}
+
+		return true;
+	}
+
+	bool string(const std::string& value) override
+	{
+		if (array)
+		{
+			if (depth == 2)
+				array->elements.push_back(value);
+
+			return true;
+		}
+
+		return record(true, value);
+	}
+
+	bool integer(fa_json::integer) override
+	{
+		if (array)
+		{
+			array->is_string_array = false;
+			return true;
+		}
+
+		return record(false, "");
+	}
+
+	bool floating(fa_json::floating) override
+	{
+		if (array)
+		{
+			array->is_string_array = false;
+			return true;
+		}
+
+		return record(false, "");
+	}
+
+private:
+	size_t depth = 0;
+	size_t remaining = 0;
+	field* current = 0;
+
+	// Field whose array is being read
+	field* array = 0;
+
+	bool record(bool is_string, const std::string& value)
+	{
+		if (depth == 0)
+			return false;
+
+		if (depth == 1 && current)
+		{
+			current->present = true;
+			current->is_string = is_string;
+			current->value = value;
+			current = 0;
+
+			remaining--;
+			return remaining != 0;
+		}
+
+		return true;
+	}
+};
+
+static fa_Error read_string_field(const fa_ModInfoHandler& info, const std::string& field, std::string* value)
 {
 	fa_Error error;
 
-	// FactAstra version
-	auto it = obj.find(field);
+	auto it = info.fields.find(field);
 
-	if (it == obj.end())
+	if (it == info.fields.end() || !it->second.present)
 	{
 		error.code = fa_errno::invalid_json;
 		error.description = "Invalid JSON: " + field + " field was missing.";
 		return error;
 	}
 
-	if (it->second.index() != FA_JSON_STRING)
+	if (!it->second.is_string)
 	{
 		error.code = fa_errno::invalid_json;
 		error.description = "Invalid JSON: " + field + " field was of wrong type (not string).";
 		return error;
 	}
 
-	*value = std::get<fa_json::string>(it->second);
+	*value = it->second.value;
+
+	return error;
+}
+
+// Optional, an empty list when missing
+static fa_Error read_string_array_field(const fa_ModInfoHandler& info, const std::string& field, std::vector<std::string>* value)
+{
+	fa_Error error;
+
+	auto it = info.fields.find(field);
+
+	if (it == info.fields.end() || !it->second.present)
+		return error;
+
+	if (!it->second.is_string_array)
+	{
+		error.code = fa_errno::invalid_json;
+		error.description = "Invalid JSON: " + field + " field was of wrong type (not array of strings).";
+		return error;
+	}
+
+	*value = it->second.elements;
 
 	return error;
 }
@@ -35,19 +220,33 @@ static fa_Error read_string_field(const fa_json::object& obj, const std::string&
 fa_ModManager::fa_ModManager()
 {
 	fs = 0;
-	synchronized = true;
+	index_loaded = false;
 }
 
 fa_Error fa_ModManager::add_mod(const std::filesystem::path& path, bool add_additional, std::ostream& log_stream)
 {
 	fa_Error error;
 
+	auto correct = fs->getCorrectPath(path);
+	FA_TRACE_SCOPE_DETAIL("Load mod", correct.u8string());
+
 	if (add_additional)
+	{
 		additional_mods.insert(path);
+		watcher.watch_mod(correct);
+	}
 
 	fa_Mod mod;
 	error = load_mod_info(path, &mod, log_stream);
 
+	if (error.code == fa_errno::ok)
+		sources[correct] = { mod, add_additional };
+
+	return merge_mod(mod, error, add_additional, log_stream);
+}
+
+fa_Error fa_ModManager::merge_mod(const fa_Mod& mod, fa_Error error, bool add_additional, std::ostream& log_stream)
+{
 	if (error.code == fa_errno::invalid_json || error.code == fa_errno::invalid_filename || error.code == fa_errno::invalid_version_string)
 	{
 		return error;
@@ -84,7 +283,21 @@ fa_Error fa_ModManager::add_mod(const std::filesystem::path& path, bool add_addi
 		return error;
 	}
 
-	mods[mod.name] = mod;
+	// A replaced version keeps the state of the previous one, a new mod gets its state from the configuration if it has one
+	bool enabled = mod.enabled;
+
+	if (added_it != mods.end())
+		enabled = added_it->second.enabled;
+	else
+	{
+		uint32_t id = mod_ids.find(mod.name);
+
+		if (id != fa_ModIds::none && mod_config.is_present(id))
+			enabled = mod_config.is_enabled(id);
+	}
+
+	fa_Mod& merged = mods[mod.name] = mod;
+	merged.enabled = enabled;
 
 	return error;
 }
@@ -106,6 +319,7 @@ fa_Error fa_ModManager::add_mod_directory(const std::filesystem::path& path, std
 {
 	fa_Error error;
 	auto correct = fs->getCorrectPath(path);
+	FA_TRACE_SCOPE_DETAIL("Add mod directory", correct.u8string());
 
 	log_stream << "Adding mod directory at " << correct << "." << std::endl;
 
@@ -123,21 +337,93 @@ fa_Error fa_ModManager::add_mod_directory(const std::filesystem::path& path, std
 
 	if (dir_it == mod_directories.end())
 	{
-		// Add the dir and mods in it
+		// Add the dir and mods in it. Watched first, so that changes made during the scan are not missed.
 		mod_directories.insert(path);
+		watcher.watch_directory(correct);
+
+		if (!index_loaded)
+		{
+			FA_TRACE_SCOPE("Load mod index");
+			index.load(fs->getCorrectPath("__appdata__/mods/mod_index.fabin"));
+			index_loaded = true;
+		}
+
+		std::vector<std::filesystem::path> mod_paths;
 
 		for (const auto& entry : fs->getFilesInDirectory(correct))
 		{
-			std::filesystem::path mod_path = entry.path();
+			auto filename = entry.path().filename();
+
+			if (filename != "configuration.json" && filename != "mod_index.fabin" && filename != "mod_index.fabin.tmp")
+				mod_paths.push_back(entry.path());
+		}
+
+		// Mods are loaded in parallel, each logging into its own buffer. They are merged afterwards in the
+		// directory order, so the result and the log are the same as when loading them one by one.
+		// Mods whose source did not change since the last launch are taken from the index instead.
+		struct loaded_mod
+		{
+			fa_ModIndex::stamp source;
+			fa_Mod mod;
+			fa_Error error;
+			std::ostringstream log;
+		};
 
-			if (mod_path.filename() != "configuration.json")
+		std::vector<loaded_mod> loaded(mod_paths.size());
+		std::atomic<size_t> next = 0;
+
+		auto worker = [&]() {
+			for (size_t i = next++; i < mod_paths.size(); i = next++)
 			{
-				error = add_mod(mod_path, false, log_stream);
+				FA_TRACE_SCOPE_DETAIL("Load mod", mod_paths[i].u8string());
+				const fa_ModIndex::entry* cached = index.find(mod_paths[i], &loaded[i].source);
 
-				if (error.code == fa_errno::invalid_json || error.code == fa_errno::invalid_filename || error.code == fa_errno::invalid_version_string)
+				if (cached)
 				{
-					return error;
+					loaded[i].mod = cached->mod;
+					loaded[i].error = cached->error;
+					loaded[i].log << cached->log;
 				}
+				else
+					loaded[i].error = load_mod_info(mod_paths[i], &loaded[i].mod, loaded[i].log);
+			}
+		};
+
+		// Loading mostly waits for the disk, so there are more workers than cores on small machines
+		size_t worker_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 4u), mod_paths.size());
+		std::vector<std::thread> workers;
+
+		for (size_t i = 1; i < worker_count; i++)
+		{
+			workers.emplace_back([&]() {
+				FA_TRACE_THREAD("Mod loader");
+				worker();
+				});
+		}
+
+		worker();
+
+		for (auto& thread : workers)
+			thread.join();
+
+		FA_TRACE_SCOPE("Merge mods");
+
+		for (size_t i = 0; i < loaded.size(); i++)
+		{
+			auto& [source, mod, load_error, log] = loaded[i];
+
+			index.update(mod_paths[i], { source, mod, load_error, log.str() });
+
+			log_stream << log.str();
+
+			if (load_error.code == fa_errno::ok)
+				sources[mod_paths[i]] = { mod, false };
+
+			error = merge_mod(mod, load_error, false, log_stream);
+
+			if (error.code == fa_errno::invalid_json || error.code == fa_errno::invalid_filename || error.code == fa_errno::invalid_version_string)
+			{
+				return error;
 			}
 		}
 	}
@@ -149,34 +435,35 @@ fa_Error fa_ModManager::add_mod_directory(const std::filesystem::path& path, std
 	return error;
 }
 
-fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, std::ostream& log_stream)
+fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, std::ostream& log_stream, fa_ModConfig::merge_operator op, bool negate)
 {
+	FA_TRACE_SCOPE("Load mod configuration");
 	fa_Error error;
 
 	if (fs)
 	{
 		log_stream << "Loading configuration at " << fs->getCorrectPath(path) << std::endl;
 
-		fa_json config;
-
-		std::ifstream file = fs->openFile(path);
-
-		std::string line;
-		std::string source;
-
-		while (std::getline(file, line))
-			source += line;
+		// Only the few fields below are read, so the rest of the file is never decoded
+		fa_json_lazy config;
+		fa_FileBuffer file;
 
-		file.close();
+		if (!file.open(fs->getCorrectPath(path)))
+		{
+			error.code = fa_errno::fs_entry_does_not_exist;
+			error.description = "Could not open the configuration file.";
+			log_stream << error.description << std::endl;
+			return error;
+		}
 
 		fa_json_error err;
 
-		config.parse(source, &err);
+		config.parse(file.view(), &err);
 
 		if (err.code != fa_json_errno::ok)
 		{
 			error.code = fa_errno::invalid_json;
-			error.description = "Invalid JSON file: " + err.description;
+			error.description = "Invalid JSON file: " + err.description + " (line " + std::to_string(err.line) + ", column " + std::to_string(err.column) + ")";
 			log_stream << error.description << std::endl;
 			return error;
 		}
@@ -184,23 +471,21 @@ fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, st
 		// Json reading
 		// The json has to be an object optionally containing the following objects: directories, additional, configuration
 
-		if (config.index() == FA_JSON_OBJECT)
+		if (config.root().index() == FA_JSON_OBJECT)
 		{
-			const auto& object = std::get<fa_json::object>(config);
-
-			auto directories_it = object.find("directories");
-			auto additional_it = object.find("additional");
-			auto configuration_it = object.find("configuration");
-			auto ignored_it = object.find("ignored");
+			auto directories = config.at("/directories");
+			auto additional = config.at("/additional");
+			auto configuration = config.at("/configuration");
+			auto ignored = config.at("/ignored");
 
 			// Mod directories
-			if (directories_it != object.end() && directories_it->second.index() == FA_JSON_ARRAY)
+			if (directories && directories.index() == FA_JSON_ARRAY)
 			{
-				for (const auto& dir : std::get<fa_json::arr>(directories_it->second))
+				for (const auto& dir : directories.elements())
 				{
 					if (dir.index() == FA_JSON_STRING)
 					{
-						error = add_mod_directory(std::get<fa_json::string>(dir), log_stream);
+						error = add_mod_directory(dir.get_string(), log_stream);
 						
 						if (error.code == fa_errno::invalid_filename || error.code == fa_errno::invalid_json || error.code == fa_errno::invalid_version_string)
 							return error;
@@ -218,14 +503,14 @@ fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, st
 			}
 
 			// Additional mods
-			if (additional_it != object.end() && additional_it->second.index() == FA_JSON_ARRAY)
+			if (additional && additional.index() == FA_JSON_ARRAY)
 			{
 				std::string err;
-				for (const auto& mod : std::get<fa_json::arr>(additional_it->second))
+				for (const auto& mod : additional.elements())
 				{
 					if (mod.index() == FA_JSON_STRING)
 					{
-						error = add_mod(std::get<fa_json::string>(mod), true, log_stream);
+						error = add_mod(mod.get_string(), true, log_stream);
 
 						if (error.code == fa_errno::invalid_filename || error.code == fa_errno::invalid_json)
 							return error;
@@ -243,13 +528,13 @@ fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, st
 			}
 
 			// Ignored mods
-			if (ignored_it != object.end() && ignored_it->second.index() == FA_JSON_ARRAY)
+			if (ignored && ignored.index() == FA_JSON_ARRAY)
 			{
-				for (const auto& mod : std::get<fa_json::arr>(ignored_it->second))
+				for (const auto& mod : ignored.elements())
 				{
 					if (mod.index() == FA_JSON_STRING)
 					{
-						add_ignored_mod(std::get<fa_json::string>(mod));
+						add_ignored_mod(mod.get_string());
 					}
 				}
 			}
@@ -258,23 +543,23 @@ fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, st
 				log_stream << "Ignored mods configuration field was ignored because it was missing/had a wrong type (not-array)" << std::endl;
 			}
 
-			// Enabled configuration
-			if (configuration_it != object.end() && configuration_it->second.index() == FA_JSON_OBJECT)
+			// Enabled configuration, merged as whole bitsets
+			if (configuration && configuration.index() == FA_JSON_OBJECT)
 			{
-				for (const auto& [mod, enabled] : std::get<fa_json::object>(configuration_it->second))
+				fa_ModConfig loaded;
+
+				for (const auto& [mod, enabled] : configuration.members())
 				{
-					auto mod_it = mods.find(mod);
+					if (enabled.index() == FA_JSON_INTEGER)
+						loaded.set(mod_ids.add(mod), enabled.get_integer());
 
-					if (mod_it != mods.end())
-					{
-						if (enabled.index() == FA_JSON_INTEGER)
-						{
-							mod_it->second.enabled = std::get<fa_json::integer>(enabled);
-						}
-					}
-					else
-						log_stream << "Configuration for mod \"" << mod << "\" was ignored, because it did not exist." << std::endl;
+					if (!mods.count(mod))
+						log_stream << "Configuration for mod \"" << mod << "\" is kept for when it is loaded, because it did not exist." << std::endl;
 				}
+
+				store_configuration();
+				mod_config.merge(loaded, op, negate);
+				apply_configuration();
 			}
 			else
 			{
@@ -295,6 +580,7 @@ fa_Error fa_ModManager::load_configuration(const std::filesystem::path& path, st
 
 void fa_ModManager::save_configuration(const std::filesystem::path& path, std::ostream& log_stream) const
 {
+	FA_TRACE_SCOPE("Save mod configuration");
 	fa_json::object obj;
 	fa_json::arr directories;
 	fa_json::arr additional;
@@ -306,6 +592,16 @@ void fa_ModManager::save_configuration(const std::filesystem::path& path, std::o
 	for (const auto& mod : additional_mods)
 		additional.push_back(mod.string());
 
+	for (const auto& [name, mod] : mods)
+		configuration.insert({ name, (fa_json::integer)mod.enabled });
+
+	// Configured mods which are not loaded at the moment
+	for (uint32_t id = 0; id < mod_ids.size(); id++)
+	{
+		if (mod_config.is_present(id) && !mods.count(mod_ids.name(id)))
+			configuration.insert({ mod_ids.name(id), (fa_json::integer)mod_config.is_enabled(id) });
+	}
+
 	obj.insert({ "directories", directories });
 	obj.insert({ "additional", additional });
 	obj.insert({ "configuration", configuration });
@@ -318,7 +614,8 @@ void fa_ModManager::save_configuration(const std::filesystem::path& path, std::o
 	
 	auto file = fs->openOfile(path);
 
-	file << configuration_json;
+	// Pretty printed, so that the file stays readable and editable by hand
+	configuration_json.dump(file, true);
 
 	file.close();
 }
@@ -328,14 +625,134 @@ void fa_ModManager::register_fs(sp::FileSystem* _fs)
 	fs = _fs;
 }
 
+bool fa_ModManager::resync(std::ostream& log_stream, std::chrono::milliseconds debounce)
+{
+	watcher.poll();
+
+	auto paths = watcher.take_settled(debounce);
+
+	if (paths.empty())
+		return false;
+
+	std::set<std::string> names;
+
+	for (const auto& path : paths)
+	{
+		bool is_additional = std::any_of(additional_mods.begin(), additional_mods.end(), [this, &path](const std::filesystem::path& p) {
+			return fs->getCorrectPath(p) == path;
+			});
+
+		auto source_it = sources.find(path);
+
+		if (source_it != sources.end())
+		{
+			names.insert(source_it->second.mod.name);
+			sources.erase(source_it);
+		}
+
+		// Opened anew when it is needed next
+		zip_archives.close(path);
+
+		std::error_code ec;
+
+		if (!std::filesystem::exists(path, ec))
+		{
+			log_stream << "Mod at " << path << " was removed." << std::endl;
+			continue;
+		}
+
+		log_stream << "Reloading mod at " << path << "." << std::endl;
+
+		fa_ModIndex::stamp stamp;
+		const fa_ModIndex::entry* cached = index.find(path, &stamp);
+
+		fa_Mod mod;
+		fa_Error error;
+		std::ostringstream log;
+
+		if (cached)
+		{
+			mod = cached->mod;
+			error = cached->error;
+			log << cached->log;
+		}
+		else
+			error = load_mod_info(path, &mod, log);
+
+		index.update(path, { stamp, mod, error, log.str() });
+
+		log_stream << log.str();
+
+		if (error.code == fa_errno::ok)
+		{
+			sources[path] = { mod, is_additional };
+			names.insert(mod.name);
+		}
+	}
+
+	for (const auto& name : names)
+		remerge(name, log_stream);
+
+	return true;
+}
+
+void fa_ModManager::remerge(const std::string& name, std::ostream& log_stream)
+{
+	auto mod_it = mods.find(name);
+
+	// Remembered in the configuration, which merge_mod takes the state of a new mod from
+	if (mod_it != mods.end())
+	{
+		mod_config.set(mod_ids.add(name), mod_it->second.enabled);
+		mods.erase(mod_it);
+	}
+
+	for (const auto& [path, source] : sources)
+	{
+		if (source.mod.name == name)
+			merge_mod(source.mod, fa_Error(), source.is_additional, log_stream);
+	}
+}
+
+void fa_ModManager::store_configuration()
+{
+	for (const auto& [name, mod] : mods)
+		mod_config.set(mod_ids.add(name), mod.enabled);
+}
+
+void fa_ModManager::apply_configuration()
+{
+	for (auto& [name, mod] : mods)
+	{
+		uint32_t id = mod_ids.find(name);
+
+		if (id != fa_ModIds::none && mod_config.is_present(id))
+			mod.enabled = mod_config.is_enabled(id);
+	}
+}
+
+fa_ModWatcher::clock::time_point fa_ModManager::next_resync(std::chrono::milliseconds debounce) const
+{
+	return watcher.next_settled(debounce);
+}
+
+int fa_ModManager::get_watcher_fd() const
+{
+	return watcher.get_fd();
+}
+
 bool fa_ModManager::is_synchronized() const
 {
-	return synchronized;
+	return !watcher.has_pending() && !index.is_stale();
 }
 
 void fa_ModManager::synchronize()
 {
-	synchronized = true;
+	FA_TRACE_SCOPE("Save mod index");
+
+	// Mods that were not seen this session are forgotten, so the index does not grow forever
+	index.prune();
+	index.save();
 }
 
 fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod* mod_struct, std::ostream& log_stream)
@@ -350,7 +767,8 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 	if (is_dir || is_zip)
 	{
 		// Validate filename
-		std::string filename = path.filename().string();
+		std::string filename = (is_zip ? path.stem() : path.filename()).string();
+		std::filesystem::path inner_path;
 		std::string name;
 		fa_Version version;
 		bool version_valid = true;
@@ -385,9 +803,8 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 		}
 
 		// Load info.json
-		fa_json info;
+		fa_ModInfoHandler info({ "factastra_version", "name", "title", "version", "description", "dependencies" });
 		fa_json_error info_err;
-		std::string code;
 
 		if (is_dir)
 		{
@@ -400,100 +817,62 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 				return error;
 			}
 
-			auto info_stream = fs->openFile(path / "info.json");
+			// Unchanged mods are served by the mod index without reaching this, so nothing is cached next to the file
+			fa_FileBuffer info_file;
 
-			std::string line;
-
-			while (std::getline(info_stream, line))
+			if (!info_file.open(path / "info.json"))
 			{
-				code += line;
+				error.code = fa_errno::fs_entry_does_not_exist;
+				error.description = "Could not read info.json.";
+				log_stream << error.description << std::endl;
+				return error;
 			}
 
-			info_stream.close();
+			fa_json_sax_parse(info_file.view(), info, &info_err);
 		}
 		else
 		{
-			/*
-			// Zip version
-			void* stream = 0;
-			void* handle = 0;
-
-			// Open stream
-			mz_stream_os_create(&stream);
-			mz_stream_os_open(stream, path.string().c_str(), MZ_OPEN_MODE_READ);
-
-			// Open zip
-			mz_zip_create(&handle);
+			// Zip version, only the central directory and info.json are read
+			auto archive = zip_archives.open(path);
 
-			if (mz_zip_open(handle, stream, MZ_OPEN_MODE_READ))
+			if (!archive)
 			{
-				errstring = "Not a valid zip archive.";
-				*log << errstring << std::endl;
-
-				mz_zip_delete(&handle);
-				mz_stream_os_close(stream);
-				mz_stream_os_delete(&stream);
-
-				return;
+				error.code = fa_errno::not_a_mod;
+				error.description = "Not a valid zip archive.";
+				log_stream << error.description << std::endl;
+				return error;
 			}
 
-			// Get info.json location
-			if (mz_zip_locate_entry(handle, "info.json", 1))
-			{
-				if (mz_zip_locate_entry(handle, (filename + "/info.json").c_str(), 1))
-				{
-					errstring = "Missing info.json file.";
-					*log << errstring << std::endl;
+			// info.json is either in the archive root or in a folder named like the archive
+			std::string code;
 
-					// Close zip
-					mz_zip_close(handle);
-					mz_zip_delete(&handle);
-
-					// Close stream
-					//mz_stream_os_close(stream);
-					//mz_stream_os_delete(&stream);
+			if (!archive->read("info.json", code))
+			{
+				inner_path = filename;
 
-					return;
+				if (!archive->read(filename + "/info.json", code))
+				{
+					error.code = fa_errno::fs_entry_does_not_exist;
+					error.description = "Missing info.json file.";
+					log_stream << error.description << std::endl;
+					return error;
 				}
 			}
 
-			mz_zip_entry_read_open(handle, 0, 0);
-
-			mz_zip_file* info_data;
-			mz_zip_entry_get_info(handle, &info_data);
-
-			char* buff = new char[info_data->uncompressed_size + 1]{ 0 };
-			mz_zip_entry_read(handle, buff, info_data->uncompressed_size);
-
-			code = buff;
-
-			delete[] buff;
-
-			mz_zip_entry_close(handle);
-
-			// Close zip
-			mz_zip_close(handle);
-			mz_zip_delete(&handle);
-
-			// Close stream
-			mz_stream_os_close(stream);
-			mz_stream_os_delete(&stream);
-			*/
+			fa_json_sax_parse(code, info, &info_err);
 		}
 
-		info.parse(code, &info_err);
-
 		if (info_err.code != fa_json_errno::ok)
 		{
 			error.code = fa_errno::invalid_json;
-			error.description = "Invalid info.json file: " + info_err.description;
+			error.description = "Invalid info.json file: " + info_err.description + " (line " + std::to_string(info_err.line) + ", column " + std::to_string(info_err.column) + ")";
 			log_stream << error.description << std::endl;
 			return error;
 		}
 
 		// Validate and read info.json
 
-		if (info.index() != FA_JSON_OBJECT)
+		if (!info.is_object)
 		{
 			error.code = fa_errno::invalid_json;
 			error.description = "Invalid info.json file: Main structure is not an object.";
@@ -501,13 +880,11 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 			return error;
 		}
 
-		fa_json::object info_object = std::get<fa_json::object>(info);
-
 		// Required
 
 		// FactAstra version
 		std::string factastra_version_string;
-		error = read_string_field(info_object, "factastra_version", &factastra_version_string);
+		error = read_string_field(info, "factastra_version", &factastra_version_string);
 
 		if (error.code != fa_errno::ok)
 		{
@@ -533,7 +910,8 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 			return error;
 		}
 
-		if ((loaded_version.patch_parsed && loaded_version != factastra_version) || loaded_version.major != factastra_version.major || loaded_version.minor != factastra_version.minor)
+		// Without the patch number, any patch of the game's major and minor version is accepted
+		if (!fa_VersionConstraint::exactly(loaded_version).allows(factastra_version))
 		{
 			error.code = fa_errno::mod_incompatible;
 			error.description = "The loaded mod is not compatible with the game.";
@@ -545,20 +923,20 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 
 		// Name
 		std::string info_name;
-		tmp_err = read_string_field(info_object, "name", &info_name);
+		tmp_err = read_string_field(info, "name", &info_name);
 
 		if (tmp_err.code != fa_errno::ok)
 			error = tmp_err;
 
 		std::string title;
-		tmp_err = read_string_field(info_object, "title", &title);
+		tmp_err = read_string_field(info, "title", &title);
 
 		if (tmp_err.code != fa_errno::ok)
 			error = tmp_err;
 
 		fa_Version info_version;
 		std::string version_string;
-		tmp_err = read_string_field(info_object, "version", &version_string);
+		tmp_err = read_string_field(info, "version", &version_string);
 
 		if (tmp_err.code != fa_errno::ok)
 			error = tmp_err;
@@ -595,14 +973,38 @@ fa_Error fa_ModManager::load_mod_info(const std::filesystem::path& _path, fa_Mod
 
 		// Optional fields
 		std::string description;
-		read_string_field(info_object, "description", &description);
+		read_string_field(info, "description", &description);
+
+		std::vector<std::string> declarations;
+		error = read_string_array_field(info, "dependencies", &declarations);
+
+		if (error.code != fa_errno::ok)
+		{
+			log_stream << error.description << std::endl;
+			return error;
+		}
+
+		std::vector<fa_ModDependency> dependencies(declarations.size());
+
+		for (size_t i = 0; i < declarations.size(); i++)
+		{
+			if (!dependencies[i].parse(declarations[i]))
+			{
+				error.code = fa_errno::invalid_json;
+				error.description = "Invalid info.json file: dependency \"" + declarations[i] + "\" is not valid. \"[!|?] <name> [<version constraint>]\" expected, e.g. \"base >= 0.1\" or \"? other ~1.2\".";
+				log_stream << error.description << std::endl;
+				return error;
+			}
+		}
 
 		mod_struct->name = name;
 		mod_struct->title = title;
-		mod_struct->version = version;
+		mod_struct->version = info_version;
 		mod_struct->description = description;
+		mod_struct->dependencies = std::move(dependencies);
 		mod_struct->is_zip = is_zip;
 		mod_struct->path = path;
+		mod_struct->inner_path = inner_path;
 		mod_struct->enabled = true;
 	}
 	else
@@ -620,3 +1022,38 @@ const std::map<std::string, fa_Mod>& fa_ModManager::get_mods() const
 {
 	return mods;
 }
+
+const fa_Mod* fa_ModManager::find_mod(const std::string& name_or_path) const
+{
+	auto it = mods.find(name_or_path);
+
+	if (it != mods.end())
+		return &it->second;
+
+	auto path = fs->getCorrectPath(name_or_path);
+
+	for (const auto& [name, mod] : mods)
+	{
+		if (mod.path == path)
+			return &mod;
+	}
+
+	return 0;
+}
+
+bool fa_ModManager::set_enabled(const std::string& name, bool enabled)
+{
+	auto it = mods.find(name);
+
+	if (it == mods.end())
+		return false;
+
+	it->second.enabled = enabled;
+
+	return true;
+}
+
+std::shared_ptr<fa_ZipArchive> fa_ModManager::open_zip(const std::filesystem::path& path)
+{
+	return zip_archives.open(fs->getCorrectPath(path));
+}
@@ -1,6 +1,11 @@
 #pragma once
 #include "Version.hpp"
 #include "errors.hpp"
+#include "Mod.hpp"
+#include "ModIndex.hpp"
+#include "ZipArchive.hpp"
+#include "ModWatcher.hpp"
+#include "ModConfig.hpp"
 
 #include <Spectre2D/FileSystem.h>
 
@@ -9,21 +14,6 @@
 #include <filesystem>
 #include <set>
 
-struct fa_Mod
-{
-	std::string title;
-	std::string name;
-	std::string description;
-
-	bool is_zip;
-	std::filesystem::path path;
-	std::filesystem::path inner_path;
-	
-	fa_Version version;
-
-	bool enabled;
-};
-
 class fa_ModManager
 {
 public:
@@ -35,25 +25,81 @@ public:
 
 	fa_Error add_mod_directory(const std::filesystem::path& path, std::ostream& log_stream);
 
-	fa_Error load_configuration(const std::filesystem::path& path, std::ostream& log_stream);
+	// Adds the directories and mods of the configuration file. Which mods are enabled is merged into the current state with the operator.
+	fa_Error load_configuration(const std::filesystem::path& path, std::ostream& log_stream, fa_ModConfig::merge_operator op = fa_ModConfig::merge_operator::override, bool negate = false);
 	void save_configuration(const std::filesystem::path& path, std::ostream& log_stream) const;
 
 	void register_fs(sp::FileSystem* fs);
 
+	// Reloads the mods the watcher reported as created, changed or removed, once nothing happened to them for the debounce time.
+	// Only the affected mods are loaded again. Returns true if the loaded mods may have changed.
+	bool resync(std::ostream& log_stream, std::chrono::milliseconds debounce = fa_ModWatcher::default_debounce);
+
+	// When resync will next have changed mods to reload, time_point::max() if no watched mod changed
+	fa_ModWatcher::clock::time_point next_resync(std::chrono::milliseconds debounce = fa_ModWatcher::default_debounce) const;
+
+	// Readable when watched mods change, -1 if they are not watched
+	int get_watcher_fd() const;
+
+	// False while watched mods have changes resync did not apply yet, or while the mod index on disk is out of date.
+	// synchronize() writes the index.
 	bool is_synchronized() const;
 	void synchronize();
 
+	// Only reads the mod, so it can be called from several threads at once
 	fa_Error load_mod_info(const std::filesystem::path& path, fa_Mod* mod_struct, std::ostream& log_stream);
 
 	const std::map<std::string, fa_Mod>& get_mods() const;
 
+	// The mod of the name, or else the mod loaded from the path. Null if there is none.
+	const fa_Mod* find_mod(const std::string& name_or_path) const;
+
+	// Returns false if no mod has the name
+	bool set_enabled(const std::string& name, bool enabled);
+
+	// The archive of a zip mod, kept open after the first read
+	std::shared_ptr<fa_ZipArchive> open_zip(const std::filesystem::path& path);
+
 private:
 	sp::FileSystem* fs;
 
+	// Adds a mod loaded by load_mod_info, following the rules for ignored mods and versions
+	fa_Error merge_mod(const fa_Mod& mod, fa_Error error, bool add_additional, std::ostream& log_stream);
+
+	// Picks the mod of the name again from its sources, keeping whether it is enabled
+	void remerge(const std::string& name, std::ostream& log_stream);
+
+	// Copies the enabled flags of the loaded mods into mod_config, or the other way around
+	void store_configuration();
+	void apply_configuration();
+
+	// A mod loaded without errors, one for each mod path
+	struct source
+	{
+		fa_Mod mod;
+		bool is_additional = false;
+	};
+
 	std::map<std::string, fa_Mod> mods;
 	std::set<std::filesystem::path> mod_directories;
 	std::set<std::filesystem::path> additional_mods;
 	std::set<std::string> ignored_mods;
 
-	bool synchronized;
+	// Enabled flags by mod id, also of mods which were configured but are not loaded, so they keep their state when they appear.
+	// Only updated from the mods before merging configurations and when mods are reloaded.
+	fa_ModIds mod_ids;
+	fa_ModConfig mod_config;
+
+	// Every version of every mod found, by corrected path, which mods holds the chosen ones of
+	std::map<std::filesystem::path, source> sources;
+
+	// Loaded with the first mod directory
+	fa_ModIndex index;
+	bool index_loaded;
+
+	// Zip mods opened while loading their info.json, reused for reading their files later
+	fa_ZipCache zip_archives;
+
+	// Mod directories and additional mods, watched from when they are added
+	fa_ModWatcher watcher;
 };
\ No newline at end of file
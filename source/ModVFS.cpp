@@ -0,0 +1,239 @@
+#include "ModVFS.hpp"
+#include "ModManager.hpp"
+#include "FileBuffer.hpp"
+#include "Trace.hpp"
+#include "util.hpp"
+
+static std::string mod_prefix(const std::string& name)
+{
+	return "__" + name + "__/";
+}
+
+void fa_ModVFS::build(fa_ModManager& _manager, std::ostream& log_stream)
+{
+	FA_TRACE_SCOPE("Build VFS");
+	clear();
+
+	manager = &_manager;
+
+	for (const auto& [name, info] : manager->get_mods())
+	{
+		if (!info.enabled)
+			continue;
+
+		FA_TRACE_SCOPE_DETAIL("Index mod files", name);
+
+		mod m;
+		m.name = name;
+
+		if (info.is_zip)
+		{
+			m.archive = manager->open_zip(info.path);
+			m.archive_path = info.path;
+			m.inner_path = info.inner_path;
+
+			if (!m.archive)
+			{
+				log_stream << "Could not open the archive of mod \"" << name << "\", its files are not available." << std::endl;
+				continue;
+			}
+		}
+		else
+			m.root = info.path / info.inner_path;
+
+		mods.push_back(std::move(m));
+
+		if (info.is_zip)
+			add_zip((uint32_t)mods.size() - 1);
+		else
+			add_directory((uint32_t)mods.size() - 1, log_stream);
+	}
+
+	log_stream << "Indexed " << files.size() << " files of " << mods.size() << " mods." << std::endl;
+}
+
+void fa_ModVFS::clear()
+{
+	mods.clear();
+	files.clear();
+	retired.clear();
+}
+
+void fa_ModVFS::add_directory(uint32_t index, std::ostream& log_stream)
+{
+	const mod& m = mods[index];
+	std::string prefix = mod_prefix(m.name);
+
+	std::error_code ec;
+
+	for (auto it = std::filesystem::recursive_directory_iterator(m.root, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		std::error_code file_ec;
+
+		if (!it->is_regular_file(file_ec) || fa_util::is_bookkeeping_file(it->path().filename().u8string()))
+			continue;
+
+		std::string path = normalize(prefix + it->path().lexically_relative(m.root).generic_u8string());
+
+		if (!path.empty())
+			files[path] = { index, -1, it->file_size(file_ec) };
+	}
+
+	if (ec)
+		log_stream << "Could not list all files of mod \"" << m.name << "\": " << ec.message() << std::endl;
+}
+
+void fa_ModVFS::add_zip(uint32_t index)
+{
+	const mod& m = mods[index];
+	std::string prefix = mod_prefix(m.name);
+
+	// Entries outside of the folder with info.json do not belong to the mod
+	std::string inner = normalize(prefix + m.inner_path.generic_u8string()) + "/";
+
+	const auto& entries = m.archive->entries();
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].is_dir)
+			continue;
+
+		std::string path = normalize(prefix + entries[i].name);
+
+		if (path.size() > inner.size() && path.compare(0, inner.size(), inner) == 0)
+			files[prefix + path.substr(inner.size())] = { index, (int64_t)i, entries[i].size };
+	}
+}
+
+const fa_ModVFS::file* fa_ModVFS::find(std::string_view path) const
+{
+	auto it = files.find(normalize(path));
+
+	return it != files.end() ? &it->second : 0;
+}
+
+bool fa_ModVFS::exists(std::string_view path) const
+{
+	return find(path) != 0;
+}
+
+const fa_ModVFS::file* fa_ModVFS::find_current(const std::string& path)
+{
+	auto it = files.find(path);
+
+	if (it == files.end())
+		return 0;
+
+	const mod& m = mods[it->second.mod];
+
+	if (!m.archive || m.archive->is_unchanged())
+		return &it->second;
+
+	// Rewritten since it was opened, its entries may have moved
+	reopen_zip(it->second.mod);
+
+	it = files.find(path);
+
+	return it != files.end() ? &it->second : 0;
+}
+
+void fa_ModVFS::reopen_zip(uint32_t index)
+{
+	mod& m = mods[index];
+
+	retired.push_back(std::move(m.archive));
+
+	for (auto it = files.begin(); it != files.end();)
+	{
+		if (it->second.mod == index)
+			it = files.erase(it);
+		else
+			it++;
+	}
+
+	m.archive = manager->open_zip(m.archive_path);
+
+	if (m.archive)
+		add_zip(index);
+}
+
+bool fa_ModVFS::read(std::string_view _path, std::string& out)
+{
+	out.clear();
+
+	std::string path = normalize(_path);
+	const file* f = find_current(path);
+
+	if (!f)
+		return false;
+
+	const mod& m = mods[f->mod];
+
+	if (m.archive)
+		return m.archive->read(m.archive->entries()[f->entry], out);
+
+	fa_FileBuffer file;
+
+	if (!file.open(m.root / std::filesystem::u8path(path.substr(mod_prefix(m.name).size()))))
+		return false;
+
+	out.assign(file.view());
+
+	return true;
+}
+
+std::string_view fa_ModVFS::view(std::string_view path)
+{
+	const file* f = find_current(normalize(path));
+
+	if (!f || f->entry < 0)
+		return std::string_view();
+
+	const mod& m = mods[f->mod];
+
+	return m.archive->view(m.archive->entries()[f->entry]);
+}
+
+size_t fa_ModVFS::size() const
+{
+	return files.size();
+}
+
+std::string fa_ModVFS::normalize(std::string_view path)
+{
+	std::string ret;
+	size_t i = 0;
+
+	while (i < path.size())
+	{
+		size_t end = path.find_first_of("/\\", i);
+
+		if (end == std::string_view::npos)
+			end = path.size();
+
+		std::string_view segment = path.substr(i, end - i);
+		i = end + 1;
+
+		if (segment.empty() || segment == ".")
+			continue;
+
+		if (segment == "..")
+		{
+			size_t slash = ret.rfind('/');
+
+			// The first segment is the mod
+			if (slash == std::string::npos)
+				return "";
+
+			ret.resize(slash);
+			continue;
+		}
+
+		if (!ret.empty())
+			ret.push_back('/');
+
+		ret.append(segment);
+	}
+
+	return ret;
+}
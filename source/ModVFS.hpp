@@ -0,0 +1,83 @@
+#pragma once
+#include "Mod.hpp"
+#include "ZipArchive.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+class fa_ModManager;
+
+// Files of the enabled mods under virtual paths of the form "__<mod name>__/<path in the mod>", e.g. "__base__/graphics/belt.bmp".
+// The whole index is built when the mods are loaded, so lookups are a single hash map access without touching the disk.
+// Files of zip mods are read through the archives the mod manager keeps open. An archive whose file changed is opened anew
+// before it is read, so that a rewritten zip is never read through its old mapping.
+class fa_ModVFS
+{
+public:
+	struct file
+	{
+		// Index of the mod in the VFS
+		uint32_t mod = 0;
+
+		// Index of the entry in the archive of a zip mod, -1 for files of directory mods
+		int64_t entry = -1;
+
+		uint64_t size = 0;
+	};
+
+	// Indexes the files of every enabled mod, replacing the previous index
+	void build(fa_ModManager& manager, std::ostream& log_stream);
+	void clear();
+
+	// Paths are normalized first, 0 if there is no such file
+	const file* find(std::string_view path) const;
+	bool exists(std::string_view path) const;
+
+	// Reads the whole file, returns false if it is missing or could not be read
+	bool read(std::string_view path, std::string& out);
+
+	// Contents of a file stored uncompressed in a zip mod, without copying. Valid while the VFS is not rebuilt.
+	// Empty for other files, which have to be read.
+	std::string_view view(std::string_view path);
+
+	size_t size() const;
+
+	// Uses '/' as separator and resolves "." and ".." segments. Paths leaving the mod return an empty string.
+	// Letters keep their case, so that paths behave the same on every platform.
+	static std::string normalize(std::string_view path);
+
+private:
+	struct mod
+	{
+		std::string name;
+
+		// Root of the mod's files on disk, for directory mods
+		std::filesystem::path root;
+
+		// Open archive of zip mods, with its path and the folder holding info.json in it
+		std::shared_ptr<fa_ZipArchive> archive;
+		std::filesystem::path archive_path;
+		std::filesystem::path inner_path;
+	};
+
+	fa_ModManager* manager = 0;
+
+	std::vector<mod> mods;
+	std::unordered_map<std::string, file> files;
+
+	// Archives replaced by reopen_zip, kept until the next build so that views into them stay valid
+	std::vector<std::shared_ptr<fa_ZipArchive>> retired;
+
+	void add_directory(uint32_t index, std::ostream& log_stream);
+	void add_zip(uint32_t index);
+
+	// Same as find on a normalized path, but reopens the archive of a zip mod first if its file changed
+	const file* find_current(const std::string& path);
+
+	// Opens the archive of a zip mod anew and indexes its entries again. Its files are unavailable if it can not be opened.
+	void reopen_zip(uint32_t index);
+};
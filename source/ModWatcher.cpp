@@ -0,0 +1,271 @@
+#include "ModWatcher.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// Files the game itself writes next to mods and into them, which are not changes of a mod
+static bool is_bookkeeping_file(const std::string& name)
+{
+	return name == "configuration.json" || fa_util::is_bookkeeping_file(name);
+}
+
+#ifdef __linux__
+
+static const uint32_t watch_mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+fa_ModWatcher::fa_ModWatcher()
+{
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+fa_ModWatcher::~fa_ModWatcher()
+{
+	if (fd >= 0)
+		::close(fd);
+}
+
+fa_ModWatcher::watch* fa_ModWatcher::add_watch(const std::filesystem::path& path, bool is_mod_directory, bool is_mod)
+{
+	if (fd < 0)
+		return 0;
+
+	// Watching the same directory again gives back the same descriptor, so the roles add up
+	int wd = inotify_add_watch(fd, path.c_str(), watch_mask);
+
+	if (wd < 0)
+		return 0;
+
+	watch& w = watches[wd];
+	w.path = path;
+	w.is_mod_directory |= is_mod_directory;
+	w.is_mod |= is_mod;
+
+	return &w;
+}
+
+void fa_ModWatcher::clear()
+{
+	if (fd >= 0)
+	{
+		for (const auto& [wd, w] : watches)
+			inotify_rm_watch(fd, wd);
+
+		// Drops the events of the removed watches which were not read yet
+		poll();
+	}
+
+	watches.clear();
+	pending.clear();
+}
+
+void fa_ModWatcher::poll()
+{
+	if (fd < 0)
+		return;
+
+	alignas(inotify_event) char buffer[16 * 1024];
+	ssize_t length;
+
+	while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* it = buffer; it < buffer + length;)
+		{
+			const inotify_event* event = (const inotify_event*)it;
+
+			handle_event(event->wd, event->mask, event->len ? std::string(event->name) : std::string());
+
+			it += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+
+bool fa_ModWatcher::has_pending() const
+{
+	if (!pending.empty())
+		return true;
+
+	if (fd < 0)
+		return false;
+
+	pollfd descriptor = { fd, POLLIN, 0 };
+
+	return ::poll(&descriptor, 1, 0) > 0;
+}
+
+bool fa_ModWatcher::is_supported() const
+{
+	return fd >= 0;
+}
+
+#else
+
+fa_ModWatcher::fa_ModWatcher()
+	: fd(-1)
+{
+}
+
+fa_ModWatcher::~fa_ModWatcher()
+{
+}
+
+fa_ModWatcher::watch* fa_ModWatcher::add_watch(const std::filesystem::path& path, bool is_mod_directory, bool is_mod)
+{
+	return 0;
+}
+
+void fa_ModWatcher::clear()
+{
+	watches.clear();
+	pending.clear();
+}
+
+void fa_ModWatcher::poll()
+{
+}
+
+bool fa_ModWatcher::has_pending() const
+{
+	return !pending.empty();
+}
+
+bool fa_ModWatcher::is_supported() const
+{
+	return false;
+}
+
+#endif
+
+void fa_ModWatcher::watch_directory(const std::filesystem::path& path)
+{
+	if (!add_watch(path, true, false))
+		return;
+
+	std::error_code ec;
+
+	for (const auto& entry : std::filesystem::directory_iterator(path, ec))
+	{
+		if (entry.is_directory(ec))
+			add_watch(entry.path(), false, true);
+	}
+}
+
+void fa_ModWatcher::watch_mod(const std::filesystem::path& path)
+{
+	watch* parent = add_watch(path.parent_path(), false, false);
+
+	if (!parent)
+		return;
+
+	parent->mods.insert(path.filename().string());
+
+	std::error_code ec;
+
+	if (std::filesystem::is_directory(path, ec))
+		add_watch(path, false, true);
+}
+
+fa_ModWatcher::clock::time_point fa_ModWatcher::next_settled(std::chrono::milliseconds debounce) const
+{
+	clock::time_point ret = clock::time_point::max();
+
+	for (const auto& [path, time] : pending)
+		ret = std::min(ret, time + debounce);
+
+	return ret;
+}
+
+int fa_ModWatcher::get_fd() const
+{
+	return fd;
+}
+
+std::vector<std::filesystem::path> fa_ModWatcher::take_settled(std::chrono::milliseconds debounce)
+{
+	std::vector<std::filesystem::path> settled;
+	auto now = clock::now();
+
+	for (auto it = pending.begin(); it != pending.end();)
+	{
+		if (now - it->second >= debounce)
+		{
+			settled.push_back(it->first);
+			it = pending.erase(it);
+		}
+		else
+			it++;
+	}
+
+	return settled;
+}
+
+void fa_ModWatcher::handle_event(int wd, uint32_t mask, const std::string& name)
+{
+	auto now = clock::now();
+
+#ifdef __linux__
+	// Events were lost, so everything watched is checked again
+	if (mask & IN_Q_OVERFLOW)
+	{
+		std::error_code ec;
+
+		for (const auto& [_, w] : watches)
+		{
+			if (w.is_mod)
+				pending[w.path] = now;
+
+			for (const auto& mod : w.mods)
+				pending[w.path / mod] = now;
+
+			if (w.is_mod_directory)
+			{
+				for (const auto& entry : std::filesystem::directory_iterator(w.path, ec))
+				{
+					if (!is_bookkeeping_file(entry.path().filename().string()))
+						pending[entry.path()] = now;
+				}
+			}
+		}
+
+		return;
+	}
+
+	auto it = watches.find(wd);
+
+	if (it == watches.end())
+		return;
+
+	// The directory is gone, its removal is reported by the parent
+	if (mask & IN_IGNORED)
+	{
+		watches.erase(it);
+		return;
+	}
+
+	// Copied, as add_watch below may move the watches around
+	watch w = it->second;
+
+	if (w.is_mod && !is_bookkeeping_file(name))
+		pending[w.path] = now;
+
+	if (name.empty())
+		return;
+
+	std::filesystem::path child = w.path / name;
+
+	if ((w.is_mod_directory && !is_bookkeeping_file(name)) || w.mods.count(name))
+	{
+		pending[child] = now;
+
+		// A new directory mod, whose info.json has to be watched too
+		if ((mask & IN_ISDIR) && (mask & (IN_CREATE | IN_MOVED_TO)))
+			add_watch(child, false, true);
+	}
+#endif
+}
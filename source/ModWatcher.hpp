@@ -0,0 +1,77 @@
+#pragma once
+#include <filesystem>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Watches mod directories and single mods for changes, through inotify on Linux. Elsewhere no changes are reported.
+// Events are collected per mod path and reported once nothing happened to the path for the debounce time,
+// so a mod being copied in or saved in several writes is reloaded only once.
+// In directory mods only the files directly in the mod root are watched, which is where info.json is.
+class fa_ModWatcher
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	static constexpr std::chrono::milliseconds default_debounce = std::chrono::milliseconds(250);
+
+	fa_ModWatcher();
+	fa_ModWatcher(const fa_ModWatcher&) = delete;
+	~fa_ModWatcher();
+
+	fa_ModWatcher& operator=(const fa_ModWatcher&) = delete;
+
+	bool is_supported() const;
+
+	// Reports every mod created, changed or removed in the directory
+	void watch_directory(const std::filesystem::path& path);
+
+	// Reports changes of a single directory or zip mod
+	void watch_mod(const std::filesystem::path& path);
+
+	void clear();
+
+	// Reads the events which arrived since the last call, without blocking
+	void poll();
+
+	// Whether there are paths waiting for the debounce time or events which were not read yet
+	bool has_pending() const;
+
+	// When the first pending path will have waited for the debounce time, clock::time_point::max() if none is pending
+	clock::time_point next_settled(std::chrono::milliseconds debounce = default_debounce) const;
+
+	// Becomes readable when events arrive, so that a caller can sleep until then. -1 when not supported.
+	int get_fd() const;
+
+	// Mod paths nothing happened to for the debounce time, which stop being pending
+	std::vector<std::filesystem::path> take_settled(std::chrono::milliseconds debounce = default_debounce);
+
+private:
+	struct watch
+	{
+		std::filesystem::path path;
+
+		// Every entry of the directory is a mod
+		bool is_mod_directory = false;
+
+		// The directory is a mod itself, any change in it is a change of the mod
+		bool is_mod = false;
+
+		// Names of single mods watched through their parent directory
+		std::set<std::string> mods;
+	};
+
+	// inotify descriptor, -1 when not supported
+	int fd;
+
+	std::unordered_map<int, watch> watches;
+
+	// Mod paths with the time of their last event
+	std::map<std::filesystem::path, clock::time_point> pending;
+
+	watch* add_watch(const std::filesystem::path& path, bool is_mod_directory, bool is_mod);
+	void handle_event(int wd, uint32_t mask, const std::string& name);
+};
@@ -0,0 +1,160 @@
+#include "Trace.hpp"
+#include "json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	struct thread_buffer
+	{
+		int64_t id = 0;
+		std::string name;
+
+		// Grows in blocks, recorded events are never moved
+		std::deque<fa_Tracer::event> events;
+	};
+
+	std::atomic<bool> enabled(false);
+	std::chrono::steady_clock::time_point origin;
+
+	// Buffers of all threads which recorded something, kept after their threads exit
+	std::mutex buffers_mutex;
+	std::vector<std::shared_ptr<thread_buffer>> buffers;
+
+	thread_buffer& local_buffer()
+	{
+		thread_local std::shared_ptr<thread_buffer> buffer;
+
+		if (!buffer)
+		{
+			buffer = std::make_shared<thread_buffer>();
+
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			buffer->id = (int64_t)buffers.size() + 1;
+			buffers.push_back(buffer);
+		}
+
+		return *buffer;
+	}
+}
+
+void fa_Tracer::start()
+{
+	origin = std::chrono::steady_clock::now();
+	enabled = true;
+}
+
+bool fa_Tracer::is_enabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void fa_Tracer::name_thread(const std::string& name)
+{
+	if (is_enabled())
+		local_buffer().name = name;
+}
+
+int64_t fa_Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void fa_Tracer::record(event e)
+{
+	local_buffer().events.push_back(std::move(e));
+}
+
+bool fa_Tracer::write(const std::filesystem::path& path)
+{
+	if (!enabled.exchange(false))
+		return true;
+
+	fa_json::arr events;
+
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+
+	for (const auto& buffer : buffers)
+	{
+		if (!buffer->name.empty())
+		{
+			events.push_back(fa_json::object{
+				{ "name", "thread_name" },
+				{ "ph", "M" },
+				{ "pid", (fa_json::integer)1 },
+				{ "tid", buffer->id },
+				{ "args", fa_json::object{ { "name", buffer->name } } },
+			});
+		}
+
+		for (const auto& e : buffer->events)
+		{
+			fa_json::object span = {
+				{ "name", e.name },
+				{ "ph", "X" },
+				{ "pid", (fa_json::integer)1 },
+				{ "tid", buffer->id },
+
+				// Microseconds, fractions keep the nanoseconds
+				{ "ts", e.start / 1000.0 },
+				{ "dur", e.duration / 1000.0 },
+			};
+
+			if (!e.detail.empty())
+				span.insert({ "args", fa_json::object{ { "detail", e.detail } } });
+
+			events.push_back(std::move(span));
+		}
+
+		buffer->events.clear();
+	}
+
+	fa_json root = fa_json::object{
+		{ "traceEvents", std::move(events) },
+		{ "displayTimeUnit", "ms" },
+	};
+
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file)
+		return false;
+
+	root.dump(file);
+
+	return (bool)file;
+}
+
+fa_TraceSpan::fa_TraceSpan(const char* name)
+	: active(fa_Tracer::is_enabled())
+{
+	if (active)
+	{
+		e.name = name;
+		e.start = fa_Tracer::now();
+	}
+}
+
+fa_TraceSpan::~fa_TraceSpan()
+{
+	// Spans still open when the trace is written are dropped, their end is unknown
+	if (active && fa_Tracer::is_enabled())
+	{
+		e.duration = fa_Tracer::now() - e.start;
+		fa_Tracer::record(std::move(e));
+	}
+}
+
+bool fa_TraceSpan::is_active() const
+{
+	return active;
+}
+
+void fa_TraceSpan::set_detail(std::string detail)
+{
+	e.detail = std::move(detail);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Spans of time spent in parts of the game, written as a Chrome trace (JSON), which chrome://tracing and Perfetto open.
+// Every thread records into its own buffer without locking. Spans are only recorded between start() and write(), and are
+// compiled out entirely unless FA_TRACE is defined (the ENABLE_TRACING CMake option).
+class fa_Tracer
+{
+public:
+	struct event
+	{
+		// A string literal, so that recording does not copy it
+		const char* name = "";
+		std::string detail;
+
+		// Nanoseconds since start()
+		int64_t start = 0;
+		int64_t duration = 0;
+	};
+
+	static void start();
+	static bool is_enabled();
+
+	// Shown as the name of the calling thread's track
+	static void name_thread(const std::string& name);
+
+	// Nanoseconds since start(), on a monotonic clock
+	static int64_t now();
+
+	static void record(event e);
+
+	// Writes all spans recorded so far and stops recording. Threads which are still recording have to be stopped first.
+	static bool write(const std::filesystem::path& path);
+};
+
+// Records the time from its construction to its destruction
+class fa_TraceSpan
+{
+public:
+	explicit fa_TraceSpan(const char* name);
+	~fa_TraceSpan();
+
+	fa_TraceSpan(const fa_TraceSpan&) = delete;
+	fa_TraceSpan& operator=(const fa_TraceSpan&) = delete;
+
+	bool is_active() const;
+
+	// Shown in the span's arguments, e.g. the path of the mod being loaded
+	void set_detail(std::string detail);
+
+private:
+	fa_Tracer::event e;
+	bool active;
+};
+
+#define FA_TRACE_JOIN2(a, b) a##b
+#define FA_TRACE_JOIN(a, b) FA_TRACE_JOIN2(a, b)
+
+#ifdef FA_TRACE
+// Traces the rest of the enclosing scope. The detail is only evaluated while tracing.
+#define FA_TRACE_SCOPE(name) fa_TraceSpan FA_TRACE_JOIN(fa_trace_span_, __LINE__)(name)
+#define FA_TRACE_SCOPE_DETAIL(name, detail) fa_TraceSpan FA_TRACE_JOIN(fa_trace_span_, __LINE__)(name); \
+	if (FA_TRACE_JOIN(fa_trace_span_, __LINE__).is_active()) FA_TRACE_JOIN(fa_trace_span_, __LINE__).set_detail(detail)
+#define FA_TRACE_THREAD(name) fa_Tracer::name_thread(name)
+#else
+#define FA_TRACE_SCOPE(name) ((void)0)
+#define FA_TRACE_SCOPE_DETAIL(name, detail) ((void)0)
+#define FA_TRACE_THREAD(name) ((void)0)
+#endif
@@ -1,18 +1,26 @@
 #include "Version.hpp"
 #include "errors.hpp"
 
-static int64_t parse_integer(std::string::const_iterator& it, std::string::const_iterator end)
+// Returns false if the number is above key_limit, as key() and the ordering built on it could not tell such numbers apart
+static bool parse_number(std::string::const_iterator& it, std::string::const_iterator end, uint32_t* number)
 {
 	int64_t ret = 0;
 
 	while (it != end && *it >= '0' && *it <= '9')
 	{
-		ret *= 10;
-		ret += (int64_t)*it - '0';
+		// Stops growing once too large, the rest of the digits is still skipped
+		if (ret <= fa_Version::key_limit)
+			ret = ret * 10 + (*it - '0');
+
 		it++;
 	}
 
-	return ret;
+	if (ret > fa_Version::key_limit)
+		return false;
+
+	*number = (uint32_t)ret;
+
+	return true;
 }
 
 fa_Version::fa_Version(uint32_t maj, uint32_t min, uint32_t pat)
@@ -23,10 +31,13 @@ fa_Version::fa_Version(uint32_t maj, uint32_t min, uint32_t pat)
 char fa_Version::parse(const std::string& vstr)
 {
 	major = minor = patch = 0;
+	major_parsed = minor_parsed = patch_parsed = false;
 
 	auto it = vstr.begin();
 
-	major = parse_integer(it, vstr.end());
+	if (!parse_number(it, vstr.end(), &major))
+		return *vstr.begin();
+
 	major_parsed = true;
 
 	if (it == vstr.end())
@@ -40,7 +51,11 @@ char fa_Version::parse(const std::string& vstr)
 	if (it == vstr.end())
 		return '.';
 
-	minor = parse_integer(it, vstr.end());
+	auto minor_begin = it;
+
+	if (!parse_number(it, vstr.end(), &minor))
+		return *minor_begin;
+
 	minor_parsed = true;
 
 	if (it == vstr.end())
@@ -54,7 +69,11 @@ char fa_Version::parse(const std::string& vstr)
 	if (it == vstr.end())
 		return '.';
 
-	patch = parse_integer(it, vstr.end());
+	auto patch_begin = it;
+
+	if (!parse_number(it, vstr.end(), &patch))
+		return *patch_begin;
+
 	patch_parsed = true;
 
 	if (it != vstr.end())
@@ -78,14 +97,256 @@ bool fa_Version::operator!=(const fa_Version& other) const
 	return major != other.major || minor != other.minor || patch != other.patch;
 }
 
+uint64_t fa_Version::key() const
+{
+	auto clamp = [](uint32_t number) {
+		return (uint64_t)(number < key_limit ? number : key_limit);
+	};
+
+	return clamp(major) << (2 * key_bits) | clamp(minor) << key_bits | clamp(patch);
+}
+
+fa_Version fa_Version::from_key(uint64_t key)
+{
+	return fa_Version((uint32_t)(key >> (2 * key_bits)) & key_limit, (uint32_t)(key >> key_bits) & key_limit, (uint32_t)key & key_limit);
+}
+
+bool fa_Version::operator<(const fa_Version& other) const
+{
+	return key() < other.key();
+}
+
+bool fa_Version::operator<=(const fa_Version& other) const
+{
+	return key() <= other.key();
+}
+
 bool fa_Version::operator>(const fa_Version& other) const
 {
-	return major > other.major || (major == other.major && (minor > other.minor || (minor == other.minor && (patch > other.patch))));
+	return key() > other.key();
 }
 
 bool fa_Version::operator>=(const fa_Version& other) const
 {
-	return major > other.major || (major == other.major && (minor > other.minor || (minor == other.minor && (patch >= other.patch))));
+	return key() >= other.key();
+}
+
+// Number of parts given in the version, all three for versions which were not parsed
+static int given_parts(const fa_Version& version)
+{
+	if (version.patch_parsed || !version.major_parsed)
+		return 3;
+
+	return version.minor_parsed ? 2 : 1;
+}
+
+// Key of the first version after all those starting with the first parts of the version
+static uint64_t prefix_end(const fa_Version& version, int parts)
+{
+	uint64_t key = version.key();
+	int shift = (3 - parts) * fa_Version::key_bits;
+
+	return ((key >> shift) + 1) << shift;
+}
+
+static bool is_separator(char c)
+{
+	return c == ' ' || c == '\t' || c == ',';
+}
+
+fa_VersionConstraint fa_VersionConstraint::exactly(const fa_Version& version)
+{
+	fa_VersionConstraint ret;
+	ret.low = version.key();
+	ret.high = prefix_end(version, given_parts(version));
+
+	return ret;
+}
+
+bool fa_VersionConstraint::parse(const std::string& text)
+{
+	*this = fa_VersionConstraint();
+
+	size_t i = 0;
+
+	auto skip_separators = [&]() {
+		while (i < text.size() && is_separator(text[i]))
+			i++;
+	};
+
+	auto skip_spaces = [&]() {
+		while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+			i++;
+	};
+
+	auto read_version = [&](fa_Version& version) {
+		skip_spaces();
+
+		size_t begin = i;
+
+		while (i < text.size() && ((text[i] >= '0' && text[i] <= '9') || text[i] == '.'))
+			i++;
+
+		return i != begin && text[begin] != '.' && !version.parse(text.substr(begin, i - begin));
+	};
+
+	enum class op
+	{
+		none,
+		equal,
+		less,
+		less_equal,
+		greater,
+		greater_equal,
+		tilde,
+		caret
+	};
+
+	static const std::pair<const char*, op> operators[] = {
+		{ "<=", op::less_equal },
+		{ ">=", op::greater_equal },
+		{ "==", op::equal },
+		{ "<", op::less },
+		{ ">", op::greater },
+		{ "=", op::equal },
+		{ "~", op::tilde },
+		{ "^", op::caret },
+	};
+
+	skip_separators();
+
+	while (i < text.size())
+	{
+		op comparison = op::none;
+
+		for (const auto& [operator_text, value] : operators)
+		{
+			size_t length = std::char_traits<char>::length(operator_text);
+
+			if (text.compare(i, length, operator_text) == 0)
+			{
+				comparison = value;
+				i += length;
+				break;
+			}
+		}
+
+		fa_Version version;
+
+		if (!read_version(version))
+			return false;
+
+		int parts = given_parts(version);
+		uint64_t start = version.key();
+		fa_VersionConstraint part;
+
+		switch (comparison)
+		{
+		case op::none:
+		{
+			// Either a single version or a range "<first> - <last>"
+			part = exactly(version);
+
+			size_t after_version = i;
+			skip_spaces();
+
+			if (i < text.size() && text[i] == '-')
+			{
+				i++;
+
+				fa_Version last;
+
+				if (!read_version(last))
+					return false;
+
+				part.high = prefix_end(last, given_parts(last));
+			}
+			else
+				i = after_version;
+
+			break;
+		}
+
+		case op::equal:
+			part = exactly(version);
+			break;
+
+		case op::less:
+			part.high = start;
+			break;
+
+		case op::less_equal:
+			part.high = prefix_end(version, parts);
+			break;
+
+		case op::greater:
+			part.low = prefix_end(version, parts);
+			break;
+
+		case op::greater_equal:
+			part.low = start;
+			break;
+
+		case op::tilde:
+			// Patch updates, or minor updates if only the major version is given
+			part.low = start;
+			part.high = prefix_end(version, parts == 1 ? 1 : 2);
+			break;
+
+		case op::caret:
+			// Updates which keep the first non-zero number
+			part.low = start;
+			part.high = prefix_end(version, version.major != 0 || parts == 1 ? 1 : version.minor != 0 || parts == 2 ? 2 : 3);
+			break;
+		}
+
+		if (i < text.size() && !is_separator(text[i]))
+			return false;
+
+		intersect(part);
+		skip_separators();
+	}
+
+	return !allows_none();
+}
+
+std::string fa_VersionConstraint::dump() const
+{
+	if (allows_none())
+		return "< 0.0.0";
+
+	if (high - low == 1)
+		return "= " + fa_Version::from_key(low).dump();
+
+	std::string ret;
+
+	if (low != 0)
+		ret = ">= " + fa_Version::from_key(low).dump();
+
+	if (high != unbounded)
+		ret += (ret.empty() ? "< " : " < ") + fa_Version::from_key(high).dump();
+
+	return ret;
+}
+
+bool fa_VersionConstraint::allows_any() const
+{
+	return low == 0 && high == unbounded;
+}
+
+bool fa_VersionConstraint::allows_none() const
+{
+	return low >= high;
+}
+
+void fa_VersionConstraint::intersect(const fa_VersionConstraint& other)
+{
+	low = low > other.low ? low : other.low;
+	high = high < other.high ? high : other.high;
+
+	// Kept as an empty interval starting at 0, which the wrap-around in allows() relies on
+	if (low >= high)
+		low = high = 0;
 }
 
 fa_Version factastra_version = fa_Version(FACTASTRA_VERSION_MAJOR, FACTASTRA_VERSION_MINOR, FACTASTRA_VERSION_PATCH);
\ No newline at end of file
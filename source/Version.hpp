@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <cstdint>
 
 #define FACTASTRA_VERSION_MAJOR 0
 #define FACTASTRA_VERSION_MINOR 0
@@ -8,6 +9,10 @@
 
 struct fa_Version
 {
+	// Bits given to each number in key(). parse rejects larger numbers, versions made with larger ones are clamped.
+	static constexpr int key_bits = 21;
+	static constexpr uint32_t key_limit = ((uint32_t)1 << key_bits) - 1;
+
 	uint32_t major = 0;
 	uint32_t minor = 0;
 	uint32_t patch = 0;
@@ -17,14 +22,60 @@ struct fa_Version
 	bool patch_parsed = false;
 
 	fa_Version(uint32_t maj = 0, uint32_t min = 0, uint32_t pat = 0);
-	
+
+	// 0 on success, else the first character which is not valid. Numbers above key_limit are not valid.
 	char parse(const std::string& vstr);
 	std::string dump() const;
 
+	// Major, minor and patch packed into the lower 63 bits, so that versions are ordered by one integer comparison
+	uint64_t key() const;
+	static fa_Version from_key(uint64_t key);
+
 	bool operator==(const fa_Version& other) const;
 	bool operator!=(const fa_Version& other) const;
+	bool operator<(const fa_Version& other) const;
+	bool operator<=(const fa_Version& other) const;
 	bool operator>(const fa_Version& other) const;
 	bool operator>=(const fa_Version& other) const;
 };
 
+// Versions allowed by a constraint such as "= 1.2", ">= 1.2 < 2", "~1.3", "^1.2" or "1.2 - 1.5".
+// The text is parsed once into a half-open interval of version keys, so checking a version is a subtraction and a comparison.
+// Comparisons separated by spaces or commas all have to hold. A partial version stands for every version starting with it,
+// so "= 1.2" allows 1.2.x, "<= 1" allows 1.x.x and "1.2 - 1.5" allows 1.5.x too.
+struct fa_VersionConstraint
+{
+	// high of a constraint with no upper bound, above every key
+	static constexpr uint64_t unbounded = (uint64_t)1 << 63;
+
+	uint64_t low = 0;
+	uint64_t high = unbounded;
+
+	// Allows the version and, if the version was parsed partially, every version starting with it
+	static fa_VersionConstraint exactly(const fa_Version& version);
+
+	// Returns false if the text is not valid or allows no version. Empty text allows every version.
+	bool parse(const std::string& text);
+
+	// Shortest text parsing back into the same interval, empty if every version is allowed
+	std::string dump() const;
+
+	bool allows_any() const;
+	bool allows_none() const;
+
+	// Keeps only the versions allowed by both constraints
+	void intersect(const fa_VersionConstraint& other);
+
+	// Unsigned wrap-around turns key >= low && key < high into a single comparison
+	bool allows(uint64_t key) const
+	{
+		return key - low < high - low;
+	}
+
+	bool allows(const fa_Version& version) const
+	{
+		return allows(version.key());
+	}
+};
+
 extern fa_Version factastra_version;
\ No newline at end of file
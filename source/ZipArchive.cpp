@@ -0,0 +1,472 @@
+#include "ZipArchive.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+// Record signatures
+static const uint32_t local_header_signature = 0x04034b50;
+static const uint32_t central_header_signature = 0x02014b50;
+static const uint32_t end_signature = 0x06054b50;
+static const uint32_t zip64_end_signature = 0x06064b50;
+static const uint32_t zip64_locator_signature = 0x07064b50;
+
+static const size_t local_header_size = 30;
+static const size_t central_header_size = 46;
+static const size_t end_size = 22;
+static const size_t zip64_end_size = 56;
+static const size_t zip64_locator_size = 20;
+
+static const uint16_t method_store = 0;
+static const uint16_t method_deflate = 8;
+
+static const uint16_t flag_encrypted = 1;
+
+// Zip is little endian, fields are read byte by byte as they are not aligned
+static uint16_t read_u16(const char* p)
+{
+	const unsigned char* b = (const unsigned char*)p;
+	return (uint16_t)(b[0] | b[1] << 8);
+}
+
+static uint32_t read_u32(const char* p)
+{
+	const unsigned char* b = (const unsigned char*)p;
+	return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static uint64_t read_u64(const char* p)
+{
+	return (uint64_t)read_u32(p) | (uint64_t)read_u32(p + 4) << 32;
+}
+
+bool fa_ZipArchive::open(const std::filesystem::path& _path)
+{
+	close();
+
+	path = _path;
+
+	// Entries are read in any order, so the mapping is not marked as sequential
+	if (!file.open(path, false) || !read_central_directory())
+	{
+		close();
+		return false;
+	}
+
+	if (file.is_mapped())
+	{
+		std::error_code ec;
+		mapped_size = std::filesystem::file_size(path, ec);
+
+		if (!ec)
+			mapped_mtime = std::filesystem::last_write_time(path, ec);
+
+		if (ec || mapped_size != file.view().size())
+		{
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void fa_ZipArchive::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(fallback_mutex);
+		fallback.reset();
+	}
+
+	index.clear();
+	entry_list.clear();
+	directory = std::string_view();
+	file.close();
+}
+
+bool fa_ZipArchive::is_open() const
+{
+	return !file.view().empty();
+}
+
+const std::filesystem::path& fa_ZipArchive::get_path() const
+{
+	return path;
+}
+
+bool fa_ZipArchive::is_unchanged() const
+{
+	if (!file.is_mapped())
+		return true;
+
+	std::error_code ec;
+
+	if (std::filesystem::file_size(path, ec) != mapped_size || ec)
+		return false;
+
+	return std::filesystem::last_write_time(path, ec) == mapped_mtime && !ec;
+}
+
+const std::vector<fa_ZipArchive::entry>& fa_ZipArchive::entries() const
+{
+	return entry_list;
+}
+
+const fa_ZipArchive::entry* fa_ZipArchive::find(std::string_view name) const
+{
+	auto it = index.find(name);
+
+	return it != index.end() ? &entry_list[it->second] : 0;
+}
+
+bool fa_ZipArchive::read_central_directory()
+{
+	std::string_view archive = file.view();
+
+	if (archive.size() < end_size)
+		return false;
+
+	// The end record is last, followed only by a comment of up to 64 KiB
+	const char* begin = archive.data();
+	const char* end = 0;
+
+	for (size_t at = archive.size() - end_size + 1; at-- > 0 && archive.size() - at <= end_size + 0xFFFF;)
+	{
+		if (read_u32(begin + at) == end_signature)
+		{
+			end = begin + at;
+			break;
+		}
+	}
+
+	if (!end)
+		return false;
+
+	uint64_t count = read_u16(end + 10);
+	uint64_t directory_size = read_u32(end + 12);
+	uint64_t directory_offset = read_u32(end + 16);
+
+	// Larger archives keep the real values in the zip64 end record, found through the locator right before the end record
+	if (count == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF)
+	{
+		const char* locator = end - begin >= (ptrdiff_t)zip64_locator_size ? end - zip64_locator_size : 0;
+
+		if (!locator || read_u32(locator) != zip64_locator_signature)
+			return false;
+
+		uint64_t zip64_offset = read_u64(locator + 8);
+
+		if (archive.size() < zip64_end_size || zip64_offset > archive.size() - zip64_end_size || read_u32(begin + zip64_offset) != zip64_end_signature)
+			return false;
+
+		const char* zip64_end = begin + zip64_offset;
+
+		count = read_u64(zip64_end + 32);
+		directory_size = read_u64(zip64_end + 40);
+		directory_offset = read_u64(zip64_end + 48);
+	}
+
+	if (directory_offset > archive.size() || directory_size > archive.size() - directory_offset)
+		return false;
+
+	const char* it = begin + directory_offset;
+	const char* directory_end = it + directory_size;
+
+	directory = std::string_view(it, (size_t)directory_size);
+
+	// Every header takes at least its fixed part, which bounds the count of a damaged archive
+	entry_list.reserve((size_t)std::min<uint64_t>(count, directory_size / central_header_size));
+
+	for (uint64_t i = 0; i < count; i++)
+	{
+		if ((size_t)(directory_end - it) < central_header_size || read_u32(it) != central_header_signature)
+			return false;
+
+		size_t name_length = read_u16(it + 28);
+		size_t extra_length = read_u16(it + 30);
+		size_t comment_length = read_u16(it + 32);
+
+		if ((size_t)(directory_end - it) < central_header_size + name_length + extra_length + comment_length)
+			return false;
+
+		entry e;
+		e.flags = read_u16(it + 8);
+		e.method = read_u16(it + 10);
+		e.crc = read_u32(it + 16);
+		e.compressed_size = read_u32(it + 20);
+		e.size = read_u32(it + 24);
+		e.offset = read_u32(it + 42);
+		e.name.assign(it + central_header_size, name_length);
+		e.is_dir = !e.name.empty() && e.name.back() == '/';
+
+		// The zip64 extra field holds the values which did not fit, in this order
+		const char* extra = it + central_header_size + name_length;
+		const char* extra_end = extra + extra_length;
+
+		while (extra_end - extra >= 4)
+		{
+			uint16_t id = read_u16(extra);
+			uint16_t length = read_u16(extra + 2);
+			const char* field = extra + 4;
+
+			if ((size_t)(extra_end - field) < length)
+				break;
+
+			if (id == 0x0001)
+			{
+				const char* field_end = field + length;
+
+				for (uint64_t* value : { &e.size, &e.compressed_size, &e.offset })
+				{
+					if (*value == 0xFFFFFFFF && field_end - field >= 8)
+					{
+						*value = read_u64(field);
+						field += 8;
+					}
+				}
+			}
+
+			extra = extra + 4 + length;
+		}
+
+		entry_list.push_back(std::move(e));
+
+		it += central_header_size + name_length + extra_length + comment_length;
+	}
+
+	// First of duplicate names wins, same as minizip
+	for (size_t i = 0; i < entry_list.size(); i++)
+		index.insert({ entry_list[i].name, i });
+
+	return true;
+}
+
+std::string_view fa_ZipArchive::central_directory() const
+{
+	return directory;
+}
+
+std::string_view fa_ZipArchive::data(const entry& e) const
+{
+	std::string_view archive = file.view();
+
+	if (e.offset > archive.size() || archive.size() - e.offset < local_header_size)
+		return std::string_view();
+
+	const char* header = archive.data() + e.offset;
+
+	if (read_u32(header) != local_header_signature)
+		return std::string_view();
+
+	// The local extra field may differ from the one in the central directory
+	uint64_t data_offset = e.offset + local_header_size + read_u16(header + 26) + read_u16(header + 28);
+
+	if (data_offset > archive.size() || archive.size() - data_offset < e.compressed_size)
+		return std::string_view();
+
+	return archive.substr((size_t)data_offset, (size_t)e.compressed_size);
+}
+
+std::string_view fa_ZipArchive::view(const entry& e) const
+{
+	if (e.method != method_store || (e.flags & flag_encrypted) || e.compressed_size != e.size || !is_unchanged())
+		return std::string_view();
+
+	return data(e);
+}
+
+bool fa_ZipArchive::read(const entry& e, char* out) const
+{
+	if ((e.flags & flag_encrypted) || !is_unchanged())
+		return false;
+
+	if (e.method == method_store || e.method == method_deflate)
+	{
+		std::string_view compressed = data(e);
+
+		if (compressed.size() != e.compressed_size)
+			return false;
+
+		if (e.method == method_store)
+		{
+			if (e.compressed_size != e.size)
+				return false;
+
+			if (e.size)
+				std::memcpy(out, compressed.data(), compressed.size());
+		}
+		else
+		{
+			// Raw deflate, inflated in one go from the mapping into the caller's buffer
+			z_stream stream = {};
+
+			if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+				return false;
+
+			stream.next_in = (Bytef*)compressed.data();
+			stream.next_out = (Bytef*)out;
+
+			size_t in_left = compressed.size();
+			size_t out_left = (size_t)e.size;
+			int result = Z_OK;
+
+			// zlib counts in 32 bits, so huge entries are fed in parts
+			while (result == Z_OK)
+			{
+				if (!stream.avail_in)
+				{
+					stream.avail_in = (uInt)std::min<size_t>(in_left, UINT_MAX);
+					in_left -= stream.avail_in;
+				}
+
+				if (!stream.avail_out)
+				{
+					stream.avail_out = (uInt)std::min<size_t>(out_left, UINT_MAX);
+					out_left -= stream.avail_out;
+				}
+
+				result = inflate(&stream, Z_NO_FLUSH);
+			}
+
+			bool complete = result == Z_STREAM_END && !stream.avail_out && !out_left;
+
+			inflateEnd(&stream);
+
+			if (!complete)
+				return false;
+		}
+
+		// Sizes are checked above, the checksum catches damaged data
+		uLong crc = crc32(0, 0, 0);
+
+		for (uint64_t done = 0; done < e.size;)
+		{
+			uInt part = (uInt)std::min<uint64_t>(e.size - done, UINT_MAX);
+			crc = crc32(crc, (const Bytef*)out + done, part);
+			done += part;
+		}
+
+		return crc == e.crc;
+	}
+
+	// Other methods are left to minizip, which reads the same mapping
+	std::string decoded;
+
+	{
+		std::lock_guard<std::mutex> lock(fallback_mutex);
+
+		if (!fallback)
+		{
+			fallback = std::make_unique<fa_ZipReader>();
+
+			if (!fallback->open(file.view()))
+			{
+				fallback.reset();
+				return false;
+			}
+		}
+	}
+
+	if (!fallback->read(e.name, decoded) || decoded.size() != e.size)
+		return false;
+
+	if (e.size)
+		std::memcpy(out, decoded.data(), decoded.size());
+
+	return true;
+}
+
+bool fa_ZipArchive::read(const entry& e, std::string& out) const
+{
+	out.clear();
+
+	// Sizes of damaged entries can be anything, so they are checked before allocating. Deflate expands data at most 1032 times.
+	if (e.size > out.max_size() || e.compressed_size > file.view().size()
+		|| (e.method == method_store && e.size != e.compressed_size) || (e.method == method_deflate && e.size / 1032 > e.compressed_size))
+		return false;
+
+	out.resize((size_t)e.size);
+
+	if (!read(e, out.data()))
+	{
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool fa_ZipArchive::read(std::string_view name, std::string& out) const
+{
+	const entry* e = find(name);
+
+	if (!e)
+	{
+		out.clear();
+		return false;
+	}
+
+	return read(*e, out);
+}
+
+std::shared_ptr<fa_ZipArchive> fa_ZipCache::open(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	uintmax_t size = std::filesystem::file_size(path, ec);
+	std::filesystem::file_time_type mtime;
+
+	if (!ec)
+		mtime = std::filesystem::last_write_time(path, ec);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = archives.find(path);
+
+		if (it != archives.end())
+		{
+			if (!ec && it->second.size == size && it->second.mtime == mtime)
+				return it->second.reader;
+
+			// Readers still in use keep the old archive open until they are done with it
+			archives.erase(it);
+		}
+	}
+
+	if (ec)
+		return 0;
+
+	// Opened without the lock, so that mods loaded in parallel do not wait for each other's disk reads
+	auto reader = std::make_shared<fa_ZipArchive>();
+
+	if (!reader->open(path))
+		return 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Another thread may have opened the same archive meanwhile
+	return archives.insert({ path, { reader, size, mtime } }).first->second.reader;
+}
+
+void fa_ZipCache::close(const std::filesystem::path& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	archives.erase(path);
+}
+
+void fa_ZipCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	archives.clear();
+}
+
+size_t fa_ZipCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return archives.size();
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "FileBuffer.hpp"
+#include "ZipReader.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <map>
+#include <mutex>
+
+// A read-only zip archive mapped into memory once.
+// The central directory is parsed straight from the mapping, so listing and finding entries never touches the disk again.
+// Stored entries are served as views into the mapping, deflated ones are inflated from the mapping into the caller's buffer.
+// Other methods (zstd, lzma, bzip2) go through minizip, also reading from the mapping.
+// Touching pages a mapped file lost to truncation faults (SIGBUS), so reads fail once the file's size or modification time changed.
+// The archive has to be opened anew then, fa_ZipCache and fa_ModVFS do so.
+class fa_ZipArchive
+{
+public:
+	struct entry
+	{
+		std::string name;
+
+		uint16_t method = 0;
+		uint16_t flags = 0;
+		uint32_t crc = 0;
+		uint64_t compressed_size = 0;
+		uint64_t size = 0;
+
+		// Of the local header, the data follows it
+		uint64_t offset = 0;
+
+		bool is_dir = false;
+	};
+
+	fa_ZipArchive() = default;
+	fa_ZipArchive(const fa_ZipArchive&) = delete;
+
+	fa_ZipArchive& operator=(const fa_ZipArchive&) = delete;
+
+	// Returns false if the file is missing or not a valid zip archive
+	bool open(const std::filesystem::path& path);
+	void close();
+
+	bool is_open() const;
+	const std::filesystem::path& get_path() const;
+
+	// In the order of the central directory
+	const std::vector<entry>& entries() const;
+
+	// Exact name, with '/' as separator. 0 if there is no such entry.
+	const entry* find(std::string_view name) const;
+
+	// Contents of a stored entry without copying, valid while the archive is open.
+	// Empty for compressed, encrypted or damaged entries, their contents have to be read.
+	// Views into a mapped archive fault if the file is truncated while they are used.
+	std::string_view view(const entry& e) const;
+
+	// Decompresses the entry into out, which has to hold e.size bytes. Returns false if the entry is damaged or uses an unsupported method.
+	// Safe to call from several threads at once.
+	bool read(const entry& e, char* out) const;
+	bool read(const entry& e, std::string& out) const;
+
+	// Same as find and read
+	bool read(std::string_view name, std::string& out) const;
+
+	// Whether the file still has the size and modification time it had when it was mapped. Always true for small archives,
+	// which are read into memory.
+	bool is_unchanged() const;
+
+	// Raw bytes of the central directory, which change with any entry's name, size or checksum
+	std::string_view central_directory() const;
+
+private:
+	std::filesystem::path path;
+	fa_FileBuffer file;
+
+	// Of the file when it was mapped
+	uintmax_t mapped_size = 0;
+	std::filesystem::file_time_type mapped_mtime;
+
+	std::vector<entry> entry_list;
+	std::unordered_map<std::string_view, size_t> index;
+
+	std::string_view directory;
+
+	// minizip reader over the mapping, opened on the first entry it is needed for
+	mutable std::unique_ptr<fa_ZipReader> fallback;
+	mutable std::mutex fallback_mutex;
+
+	bool read_central_directory();
+
+	// Compressed data of the entry, empty if it lies outside of the archive
+	std::string_view data(const entry& e) const;
+};
+
+// Archives opened so far, kept open so that reading from them again skips opening and mapping the file.
+// An archive is opened anew when its size or modification time changes.
+class fa_ZipCache
+{
+public:
+	// The open archive, or null if it is not a valid zip archive. Safe to call from several threads.
+	std::shared_ptr<fa_ZipArchive> open(const std::filesystem::path& path);
+
+	void close(const std::filesystem::path& path);
+	void clear();
+
+	size_t size() const;
+
+private:
+	struct archive
+	{
+		std::shared_ptr<fa_ZipArchive> reader;
+		uintmax_t size = 0;
+		std::filesystem::file_time_type mtime;
+	};
+
+	mutable std::mutex mutex;
+	std::map<std::filesystem::path, archive> archives;
+};
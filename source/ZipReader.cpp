@@ -0,0 +1,85 @@
+#include "ZipReader.hpp"
+
+#include <minizip/mz.h>
+#include <minizip/mz_strm.h>
+#include <minizip/mz_zip.h>
+#include <minizip/mz_zip_rw.h>
+
+#include <climits>
+
+fa_ZipReader::fa_ZipReader()
+	: handle(0)
+{
+}
+
+fa_ZipReader::~fa_ZipReader()
+{
+	close();
+}
+
+bool fa_ZipReader::open(std::string_view data)
+{
+	close();
+
+	if (data.size() > INT32_MAX)
+		return false;
+
+	mz_zip_reader_create(&handle);
+
+	if (!handle)
+		return false;
+
+	// Not copied, minizip reads the buffer in place
+	if (mz_zip_reader_open_buffer(handle, (uint8_t*)data.data(), (int32_t)data.size(), 0) != MZ_OK)
+	{
+		mz_zip_reader_delete(&handle);
+		handle = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void fa_ZipReader::close()
+{
+	if (handle)
+	{
+		mz_zip_reader_close(handle);
+		mz_zip_reader_delete(&handle);
+		handle = 0;
+	}
+}
+
+bool fa_ZipReader::is_open() const
+{
+	return handle != 0;
+}
+
+bool fa_ZipReader::read(const std::string& name, std::string& out)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	out.clear();
+
+	if (!handle || mz_zip_reader_locate_entry(handle, name.c_str(), 0) != MZ_OK)
+		return false;
+
+	// Size from the central directory entry, so the buffer is allocated once
+	int32_t length = mz_zip_reader_entry_save_buffer_length(handle);
+
+	if (length < 0)
+		return false;
+
+	if (length == 0)
+		return true;
+
+	out.resize(length);
+
+	if (mz_zip_reader_entry_save_buffer(handle, out.data(), length) != MZ_OK)
+	{
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <mutex>
+
+// A zip archive in memory opened through minizip, for compression methods fa_ZipArchive does not decode itself.
+// Opening only reads the central directory. Entries are located in it and decompressed one by one when read.
+class fa_ZipReader
+{
+public:
+	fa_ZipReader();
+	fa_ZipReader(const fa_ZipReader&) = delete;
+	~fa_ZipReader();
+
+	fa_ZipReader& operator=(const fa_ZipReader&) = delete;
+
+	// The data is not copied and has to outlive the reader. Returns false if it is not a valid zip archive.
+	bool open(std::string_view data);
+	void close();
+
+	bool is_open() const;
+
+	// Reads the whole entry. Returns false if it is missing or damaged.
+	bool read(const std::string& name, std::string& out);
+
+private:
+	void* handle;
+
+	// minizip keeps the current entry in the handle, so reads from several threads take turns
+	std::mutex mutex;
+};
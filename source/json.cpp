@@ -1,85 +1,154 @@
 #include "json.hpp"
+#include "json_scan.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <deque>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Parser state shared by the DOM and event parsers
+struct parse_state
+{
+	std::string_view code;
+	const char* end;
+	fa_json_error* err;
+	size_t depth = 0;
 
-static void parse_value(fa_json& ret, std::string::const_iterator& it, std::string::const_iterator end, fa_json_error* err);
+	bool failed() const
+	{
+		return err->code != fa_json_errno::ok;
+	}
 
-static void await_character(const char c, bool eoi_on_end, std::string::const_iterator& it, std::string::const_iterator end, fa_json_error* err)
-{
-	while (it != end && (*it == ' ' || *it == '\n' || *it == '\r' || *it == '\t'))
-		it++;
+	// Called before descending into an object or array, which has to be followed by leave() when it succeeds
+	bool enter(const char* at)
+	{
+		if (++depth <= FA_JSON_MAX_DEPTH)
+			return true;
+
+		error(fa_json_errno::too_deep, "Objects and arrays are nested too deep.", at);
+		return false;
+	}
 
-	if (it == end && eoi_on_end)
+	void leave()
 	{
-		err->code = fa_json_errno::end_of_input;
-		err->description = "End of input when looking for '" + (c ? std::string(1, c) : "non-whitespace character") + "'.";
-		err->it = it;
+		depth--;
 	}
-	else if (c && *it != c)
+
+	void error(fa_json_errno code_, const std::string& description, const char* at)
 	{
-		err->code = fa_json_errno::unexpected_character;
-		err->description = "Unexpected character '" + std::string(1, *it) + "' when looking for '" + std::string(1, c) + "'.";
-		err->it = it;
+		fa_json_set_error(err, code_, description, code, at);
 	}
-}
+};
+
+static void parse_value(fa_json& ret, const char*& it, parse_state& state);
 
-static void parse_string(std::string& ret, std::string::const_iterator& it, std::string::const_iterator end, fa_json_error* err)
+static void await_character(const char c, bool eoi_on_end, const char*& it, parse_state& state)
 {
-	bool ignore_next = false;
+	it = fa_json_skip_whitespace(it, state.end);
 
-	while (it != end && (ignore_next || *it != '\"'))
+	if (it == state.end)
 	{
-		if (!ignore_next && *it == '\\')
-			ignore_next = true;
-		else
+		if (eoi_on_end)
+			state.error(fa_json_errno::end_of_input, "End of input when looking for '" + (c ? std::string(1, c) : "non-whitespace character") + "'.", it);
+	}
+	else if (c && *it != c)
+		state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when looking for '" + std::string(1, c) + "'.", it);
+}
+
+static void parse_string(std::string& ret, const char*& it, parse_state& state)
+{
+	while (true)
+	{
+		// Everything up to the next quote or backslash is copied at once
+		const char* special = fa_json_find_string_special(it, state.end);
+		ret.append(it, special);
+		it = special;
+
+		if (it == state.end || *it == '"')
+			break;
+
+		char decoded[4];
+		fa_json_errno error = fa_json_errno::ok;
+		size_t length = fa_json_decode_escape(++it, state.end, decoded, error);
+
+		if (error == fa_json_errno::invalid_escape)
 		{
-			ret.push_back(*it);
-			ignore_next = false;
+			state.error(error, "Invalid escape sequence when parsing a string.", it);
+			return;
 		}
 
-		it++;
-	}
+		if (!length)
+		{
+			it = state.end;
+			break;
+		}
 
-	if (it == end)
-	{
-		err->code = fa_json_errno::end_of_input;
-		err->description = "Unexpected end of input when parsing a string.";
-		err->it = it;
+		ret.append(decoded, length);
 	}
+
+	if (it == state.end)
+		state.error(fa_json_errno::end_of_input, "Unexpected end of input when parsing a string.", it);
 	else
 		it++;
 }
 
-static void parse_object(std::map<std::string, fa_json>& ret, std::string::const_iterator& it, std::string::const_iterator end, fa_json_error* err)
+static void parse_object(fa_json::object& ret, const char*& it, parse_state& state)
 {
 	std::string key;
 	fa_json value;
 
+	// Collected first and deduplicated at once, which is cheaper than one insert per member
+	std::vector<fa_json::object::value_type> members;
+
 	while (true)
 	{
 		// Wait for string
-		await_character(0, true, it, end, err);
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return;
 
 		if (*it == '"')
-			parse_string(key, ++it, end, err);
+			parse_string(key, ++it, state);
 		else if (*it == '}')
 			break;
 		else
 		{
-			err->code = fa_json_errno::unexpected_character;
-			err->description = "Unexpected character '" + std::string(1, *it) + "' when parsing object.";
-			err->it = it;
+			state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing object.", it);
 			return;
 		}
 
+		if (state.failed())
+			return;
+
 		// Wait for :
-		await_character(':', true, it, end, err);
+		await_character(':', true, it, state);
+
+		if (state.failed())
+			return;
 
 		it++;
 
-		parse_value(value, it, end, err);
+		parse_value(value, it, state);
 
-		ret.insert({ key, value });
+		if (state.failed())
+			return;
 
-		await_character(0, true, it, end, err);
+		members.emplace_back(key, std::move(value));
+
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return;
 
 		if (*it == ',')
 		{
@@ -93,32 +162,41 @@ static void parse_object(std::map<std::string, fa_json>& ret, std::string::const
 		}
 		else
 		{
-			err->code = fa_json_errno::unexpected_character;
-			err->description = "Unexpected character '" + std::string(1, *it) + "' when parsing object.";
-			err->it = it;
+			state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing object.", it);
 			return;
 		}
 	}
 
+	ret.assign(std::move(members));
+
 	it++;
 }
 
-static void parse_array(std::vector<fa_json>& ret, std::string::const_iterator& it, std::string::const_iterator end, fa_json_error* err)
+static void parse_array(std::vector<fa_json>& ret, const char*& it, parse_state& state)
 {
 	fa_json value;
 
 	while (true)
 	{
-		await_character(0, true, it, end, err);
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return;
 
 		if (*it == ']')
 			break;
 
-		parse_value(value, it, end, err);
+		parse_value(value, it, state);
 
-		ret.push_back(value);
+		if (state.failed())
+			return;
 
-		await_character(0, true, it, end, err);
+		ret.push_back(std::move(value));
+
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return;
 
 		if (*it == ',')
 		{
@@ -131,9 +209,7 @@ static void parse_array(std::vector<fa_json>& ret, std::string::const_iterator&
 		}
 		else
 		{
-			err->code = fa_json_errno::unexpected_character;
-			err->description = "Unexpected character '" + std::string(1, *it) + "' when parsing array.";
-			err->it = it;
+			state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing array.", it);
 			return;
 		}
 	}
@@ -141,86 +217,69 @@ static void parse_array(std::vector<fa_json>& ret, std::string::const_iterator&
 	it++;
 }
 
-// true -> floating point, false -> integer
-static bool parse_number(long double& ret, std::string::const_iterator& it, std::string::const_iterator end)
+static bool parse_number(fa_json_number& ret, const char*& it, parse_state& state)
 {
-	bool is_floating = false;
-	long double mul = 1;
-	ret = 0;
+	fa_json_errno error = fa_json_errno::ok;
+	const char* number_end = fa_json_parse_number(it, state.end, ret, error);
 
-	if (*it == '-')
-		mul = -1;
-
-	while (it != end && *it >= '0' && *it <= '9')
+	if (error != fa_json_errno::ok)
 	{
-		ret *= 10;
-		ret += *it - '0';
-		it++;
+		state.error(error, error == fa_json_errno::number_out_of_range ? "Number out of range." : "Invalid number.", it);
+		return false;
 	}
 
-	if (it != end && *it == '.')
-	{
-		is_floating = true;
-		long double divisor = 1;
-		it++;
+	it = number_end;
 
-		while (it != end && *it >= '0' && *it <= '9')
-		{
-			divisor *= 10;
-			ret += (*it - '0') / divisor;
-			it++;
-		}
-	}
-
-	ret *= mul;
-
-	return is_floating;
+	return true;
 }
 
-static void parse_value(fa_json& ret, std::string::const_iterator& it, std::string::const_iterator end, fa_json_error* err)
+static void parse_value(fa_json& ret, const char*& it, parse_state& state)
 {
-	await_character(0, false, it, end, err);
+	await_character(0, false, it, state);
 
-	if (it != end)
+	if (it != state.end)
 	{
 		switch (*it)
 		{
 		case '{':
+			if (!state.enter(it))
+				break;
+
 			ret = fa_json::object();
-			parse_object(std::get<fa_json::object>(ret), ++it, end, err);
+			parse_object(std::get<fa_json::object>(ret), ++it, state);
+			state.leave();
 			break;
 
 		case '[':
+			if (!state.enter(it))
+				break;
+
 			ret = fa_json::arr();
-			parse_array(std::get<fa_json::arr>(ret), ++it, end, err);
+			parse_array(std::get<fa_json::arr>(ret), ++it, state);
+			state.leave();
 			break;
 
 		case '"':
 			ret = fa_json::string();
-			parse_string(std::get<fa_json::string>(ret), ++it, end, err);
+			parse_string(std::get<fa_json::string>(ret), ++it, state);
 			break;
 
 		default:
 			if ((*it >= '0' && *it <= '9') || *it == '.' || *it == '-')
 			{
-				long double val = 0;
+				fa_json_number number;
 
 				// This time we don't advance the iterator, as the first character is already a part of the value.
-				if (parse_number(val, it, end))
-				{
-					ret = val;
-				}
-				else
+				if (parse_number(number, it, state))
 				{
-					ret = (long long)std::floor(val);
+					if (number.is_floating)
+						ret = number.floating;
+					else
+						ret = number.integer;
 				}
 			}
 			else
-			{
-				err->code = fa_json_errno::unexpected_character;
-				err->description = "Unexpected character " + std::string(1, *it) + ".";
-				err->it = it;
-			}
+				state.error(fa_json_errno::unexpected_character, "Unexpected character " + std::string(1, *it) + ".", it);
 		}
 	}
 	else
@@ -229,15 +288,29 @@ static void parse_value(fa_json& ret, std::string::const_iterator& it, std::stri
 	}
 }
 
-void fa_json::parse(const std::string& code, fa_json_error* err)
+// Only whitespace may follow the main value
+static void await_end(const char*& it, parse_state& state)
 {
-	auto it = code.begin();
-	auto end = code.end();
+	it = fa_json_skip_whitespace(it, state.end);
+
+	if (it != state.end)
+		state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' after the end of the document.", it);
+}
 
+void fa_json::parse(std::string_view code, fa_json_error* err)
+{
 	fa_json_error error;
+	parse_state state = { code, code.data() + code.size(), &error };
+
+	const char* it = code.data();
+
+	if (it != state.end)
+	{
+		parse_value(*this, it, state);
 
-	if (it != end)
-		parse_value(*this, it, end, &error);
+		if (!state.failed())
+			await_end(it, state);
+	}
 	else
 	{
 		*this = fa_json::object();
@@ -247,70 +320,396 @@ void fa_json::parse(const std::string& code, fa_json_error* err)
 		*err = error;
 }
 
-static void dump_value(std::string& ret, const fa_json& value);
+// Event (SAX) parsing. Every function returns false when the handler stopped the parse or an error occured.
+static bool sax_value(fa_json_handler& handler, std::string& buffer, const char*& it, parse_state& state);
+
+static bool sax_object(fa_json_handler& handler, std::string& buffer, const char*& it, parse_state& state)
+{
+	if (!handler.start_object())
+		return false;
+
+	while (true)
+	{
+		// Wait for string
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return false;
+
+		if (*it == '}')
+			break;
+
+		if (*it != '"')
+		{
+			state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing object.", it);
+			return false;
+		}
+
+		buffer.clear();
+		parse_string(buffer, ++it, state);
+
+		if (state.failed() || !handler.key(buffer))
+			return false;
+
+		// Wait for :
+		await_character(':', true, it, state);
+
+		if (state.failed())
+			return false;
+
+		it++;
+
+		if (!sax_value(handler, buffer, it, state))
+			return false;
+
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return false;
+
+		if (*it == ',')
+			it++;
+		else if (*it == '}')
+			break;
+		else
+		{
+			state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing object.", it);
+			return false;
+		}
+	}
+
+	it++;
+
+	return handler.end_object();
+}
 
-static void dump_array(std::string& ret, const fa_json::arr& value)
+static bool sax_array(fa_json_handler& handler, std::string& buffer, const char*& it, parse_state& state)
 {
-	ret.push_back('[');
+	if (!handler.start_array())
+		return false;
+
+	while (true)
+	{
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return false;
+
+		if (*it == ']')
+			break;
+
+		if (!sax_value(handler, buffer, it, state))
+			return false;
+
+		await_character(0, true, it, state);
+
+		if (state.failed())
+			return false;
+
+		if (*it == ',')
+			it++;
+		else if (*it == ']')
+			break;
+		else
+		{
+			state.error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing array.", it);
+			return false;
+		}
+	}
+
+	it++;
+
+	return handler.end_array();
+}
+
+static bool sax_value(fa_json_handler& handler, std::string& buffer, const char*& it, parse_state& state)
+{
+	await_character(0, true, it, state);
+
+	if (state.failed())
+		return false;
+
+	switch (*it)
+	{
+	case '{':
+	case '[':
+	{
+		if (!state.enter(it))
+			return false;
+
+		bool ret = *it == '{' ? sax_object(handler, buffer, ++it, state) : sax_array(handler, buffer, ++it, state);
+		state.leave();
+
+		return ret;
+	}
+
+	case '"':
+		buffer.clear();
+		parse_string(buffer, ++it, state);
+
+		return !state.failed() && handler.string(buffer);
+
+	default:
+		if ((*it >= '0' && *it <= '9') || *it == '.' || *it == '-')
+		{
+			fa_json_number number;
+
+			if (!parse_number(number, it, state))
+				return false;
+
+			if (number.is_floating)
+				return handler.floating(number.floating);
+			else
+				return handler.integer(number.integer);
+		}
+
+		state.error(fa_json_errno::unexpected_character, "Unexpected character " + std::string(1, *it) + ".", it);
+		return false;
+	}
+}
+
+void fa_json_sax_parse(std::string_view code, fa_json_handler& handler, fa_json_error* err)
+{
+	fa_json_error error;
+	parse_state state = { code, code.data() + code.size(), &error };
+
+	const char* it = code.data();
+
+	// Keys and strings are decoded into one buffer, so its capacity is reused across the whole document.
+	std::string buffer;
+
+	await_character(0, false, it, state);
+
+	// Empty input is an empty object, same as in fa_json::parse
+	if (it == state.end)
+	{
+		if (handler.start_object())
+			handler.end_object();
+	}
+	else if (sax_value(handler, buffer, it, state))
+		await_end(it, state);
+
+	if (err)
+		*err = error;
+}
+
+// Output targets of the serializer
+
+class string_sink
+{
+public:
+	string_sink(std::string& _ret)
+		: ret(_ret)
+	{
+	}
+
+	void put(char c)
+	{
+		ret.push_back(c);
+	}
+
+	void append(const char* data, size_t size)
+	{
+		ret.append(data, size);
+	}
+
+private:
+	std::string& ret;
+};
+
+// Collects the output in a fixed-size buffer, so the memory used does not grow with the document
+class stream_sink
+{
+public:
+	stream_sink(std::ostream& _output)
+		: output(_output)
+	{
+	}
+
+	~stream_sink()
+	{
+		flush();
+	}
+
+	void put(char c)
+	{
+		if (used == sizeof(buffer))
+			flush();
+
+		buffer[used++] = c;
+	}
+
+	void append(const char* data, size_t size)
+	{
+		if (size > sizeof(buffer) - used)
+		{
+			flush();
+
+			if (size >= sizeof(buffer))
+			{
+				output.write(data, size);
+				return;
+			}
+		}
+
+		std::copy(data, data + size, buffer + used);
+		used += size;
+	}
+
+	void flush()
+	{
+		output.write(buffer, used);
+		used = 0;
+	}
+
+private:
+	std::ostream& output;
+
+	char buffer[4096];
+	size_t used = 0;
+};
+
+// indent is the depth of the value when pretty printing and -1 otherwise
+
+template<class Sink>
+static void dump_value(Sink& ret, const fa_json& value, int indent);
+
+template<class Sink>
+static void dump_newline(Sink& ret, int indent)
+{
+	if (indent >= 0)
+	{
+		ret.put('\n');
+
+		for (int i = 0; i < indent; i++)
+			ret.put('\t');
+	}
+}
+
+template<class Sink>
+static void dump_array(Sink& ret, const fa_json::arr& value, int indent)
+{
+	ret.put('[');
+
+	int inner = indent >= 0 ? indent + 1 : indent;
 
 	for (size_t i = 0; i < value.size(); i++)
 	{
-		dump_value(ret, value[i]);
+		dump_newline(ret, inner);
+		dump_value(ret, value[i], inner);
+
 		if (i < value.size() - 1)
-			ret.push_back(',');
+			ret.put(',');
 	}
 
-	ret.push_back(']');
+	if (!value.empty())
+		dump_newline(ret, indent);
+
+	ret.put(']');
 }
 
-static void dump_floating(std::string& ret, fa_json::floating value)
+template<class Sink>
+static void dump_floating(Sink& ret, fa_json::floating value)
 {
-	ret += std::to_string(value);
+	char buffer[FA_JSON_NUMBER_BUFFER];
+	char* end = fa_json_format_number(buffer, value);
+
+	if (!end)
+		throw std::domain_error("JSON can not represent an infinite or NaN number.");
+
+	ret.append(buffer, end - buffer);
 }
 
-static void dump_integer(std::string& ret, fa_json::integer value)
+template<class Sink>
+static void dump_integer(Sink& ret, fa_json::integer value)
 {
-	ret += std::to_string(value);
+	char buffer[FA_JSON_NUMBER_BUFFER];
+	ret.append(buffer, fa_json_format_number(buffer, value) - buffer);
 }
 
-static void dump_string(std::string& ret, const fa_json::string& value)
+template<class Sink>
+static void dump_string(Sink& ret, std::string_view value)
 {
-	ret.push_back('"');
+	static const char hex[] = "0123456789abcdef";
+
+	ret.put('"');
+
+	// Characters that need no escaping are written in runs
+	const char* run = value.data();
+	const char* end = value.data() + value.size();
+
+	for (const char* it = run; it != end; it++)
+	{
+		unsigned char c = *it;
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		ret.append(run, it - run);
+		run = it + 1;
+
+		switch (c)
+		{
+		case '"': ret.append("\\\"", 2); break;
+		case '\\': ret.append("\\\\", 2); break;
+		case '\b': ret.append("\\b", 2); break;
+		case '\f': ret.append("\\f", 2); break;
+		case '\n': ret.append("\\n", 2); break;
+		case '\r': ret.append("\\r", 2); break;
+		case '\t': ret.append("\\t", 2); break;
+
+		default:
+		{
+			const char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+			ret.append(escape, 6);
+		}
+		}
+	}
 
-	ret += value;
+	ret.append(run, end - run);
 
-	ret.push_back('"');
+	ret.put('"');
 }
 
-static void dump_object(std::string& ret, const fa_json::object& value)
+template<class Sink>
+static void dump_object(Sink& ret, const fa_json::object& value, int indent)
 {
-	ret.push_back('{');
+	ret.put('{');
 
+	int inner = indent >= 0 ? indent + 1 : indent;
 	size_t i = 0;
 
 	for (const auto& [key, val] : value)
 	{
-		dump_string(ret, key);
+		dump_newline(ret, inner);
+		dump_string(ret, key.name());
+
+		ret.put(':');
 
-		ret.push_back(':');
+		if (indent >= 0)
+			ret.put(' ');
 
-		dump_value(ret, val);
+		dump_value(ret, val, inner);
 
 		if (i < value.size() - 1)
-			ret.push_back(',');
+			ret.put(',');
 
 		i++;
 	}
 
-	ret.push_back('}');
+	if (!value.empty())
+		dump_newline(ret, indent);
+
+	ret.put('}');
 }
 
-static void dump_value(std::string& ret, const fa_json& value)
+template<class Sink>
+static void dump_value(Sink& ret, const fa_json& value, int indent)
 {
 	switch (value.index())
 	{
 	case FA_JSON_ARRAY:
-		dump_array(ret, std::get<fa_json::arr>(value));
+		dump_array(ret, std::get<fa_json::arr>(value), indent);
 		break;
 
 	case FA_JSON_FLOATING:
@@ -322,7 +721,7 @@ static void dump_value(std::string& ret, const fa_json& value)
 		break;
 
 	case FA_JSON_OBJECT:
-		dump_object(ret, std::get<fa_json::object>(value));
+		dump_object(ret, std::get<fa_json::object>(value), indent);
 		break;
 
 	case FA_JSON_STRING:
@@ -331,22 +730,57 @@ static void dump_value(std::string& ret, const fa_json& value)
 	}
 }
 
-std::string fa_json::dump() const
+// Upper bound of the output size for everything but escaped characters, used to reserve the string once
+static size_t estimate_size(const fa_json& value, int indent)
+{
+	size_t separators = indent >= 0 ? indent + 4 : 2;
+	size_t ret = 0;
+
+	switch (value.index())
+	{
+	case FA_JSON_ARRAY:
+		for (const auto& element : std::get<fa_json::arr>(value))
+			ret += estimate_size(element, indent >= 0 ? indent + 1 : indent) + separators;
+
+		return ret + 2;
+
+	case FA_JSON_OBJECT:
+		for (const auto& [key, element] : std::get<fa_json::object>(value))
+			ret += key.name().size() + estimate_size(element, indent >= 0 ? indent + 1 : indent) + separators + 4;
+
+		return ret + 2;
+
+	case FA_JSON_STRING:
+		return std::get<fa_json::string>(value).size() + 2;
+
+	default:
+		return FA_JSON_NUMBER_BUFFER;
+	}
+}
+
+std::string fa_json::dump(bool pretty) const
 {
 	std::string ret;
+	int indent = pretty ? 0 : -1;
 
-	dump_value(ret, *this);
+	ret.reserve(estimate_size(*this, indent));
+
+	string_sink sink(ret);
+	dump_value(sink, *this, indent);
 
 	return ret;
 }
 
-std::istream& operator>>(std::istream& input, fa_json& output)
+void fa_json::dump(std::ostream& output, bool pretty) const
 {
-	std::string line;
-	std::string source;
+	stream_sink sink(output);
+	dump_value(sink, *this, pretty ? 0 : -1);
+}
 
-	while (std::getline(input, line))
-		source += line;
+std::istream& operator>>(std::istream& input, fa_json& output)
+{
+	// Read everything at once, keeping the newlines so that error positions stay correct
+	std::string source(std::istreambuf_iterator<char>(input), {});
 
 	fa_json_error err;
 
@@ -362,10 +796,419 @@ std::istream& operator>>(std::istream& input, fa_json& output)
 
 std::ostream& operator<<(std::ostream& output, const fa_json& input)
 {
-	return output << input.dump();
+	input.dump(output);
+
+	return output;
 }
 
-fa_json_error::fa_json_error(fa_json_errno err, const std::string& desc, std::string::const_iterator iterator)
-	: code(err), description(desc), it(iterator)
+// Atoms
+
+static inline unsigned int highest_bit(uint64_t value)
 {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Names are looked up by id in segments of doubling size. Segments never move once allocated,
+// so reading a name needs no lock: whoever got an id got it after its name was stored.
+class fa_json_atom_table
+{
+public:
+	static fa_json_atom_table& get()
+	{
+		static fa_json_atom_table table;
+		return table;
+	}
+
+	uint32_t intern(std::string_view name)
+	{
+		// Recently interned keys of this thread, checked before taking the lock
+		thread_local uint32_t recent[256] = {};
+
+		uint32_t& cached = recent[std::hash<std::string_view>()(name) & 255];
+
+		if (lookup(cached) == name)
+			return cached;
+
+		{
+			std::shared_lock lock(mutex);
+			auto it = ids.find(name);
+
+			if (it != ids.end())
+				return cached = it->second;
+		}
+
+		std::unique_lock lock(mutex);
+		auto it = ids.find(name);
+
+		if (it != ids.end())
+			return cached = it->second;
+
+		return cached = add(name);
+	}
+
+	std::string_view lookup(uint32_t id) const
+	{
+		size_t slot = (size_t)id + first_segment_size;
+		unsigned int segment = highest_bit(slot) - first_segment_bits;
+
+		return segments[segment].load(std::memory_order_acquire)[slot - (first_segment_size << segment)];
+	}
+
+private:
+	static constexpr unsigned int first_segment_bits = 6;
+	static constexpr size_t first_segment_size = (size_t)1 << first_segment_bits;
+
+	// Enough for every 32-bit id
+	std::atomic<std::string_view*> segments[33 - first_segment_bits] = {};
+
+	std::shared_mutex mutex;
+	std::unordered_map<std::string_view, uint32_t> ids;
+	std::deque<std::string> names;
+	uint32_t count = 0;
+
+	fa_json_atom_table()
+	{
+		// Id 0 is the empty string, which is what the thread caches start with
+		add(std::string_view());
+	}
+
+	// Called with the lock held
+	uint32_t add(std::string_view name)
+	{
+		uint32_t id = count;
+		size_t slot = (size_t)id + first_segment_size;
+		unsigned int segment = highest_bit(slot) - first_segment_bits;
+
+		if (!segments[segment].load(std::memory_order_relaxed))
+			segments[segment].store(new std::string_view[first_segment_size << segment], std::memory_order_release);
+
+		names.emplace_back(name);
+		segments[segment].load(std::memory_order_relaxed)[slot - (first_segment_size << segment)] = names.back();
+		ids.emplace(names.back(), id);
+
+		count++;
+
+		return id;
+	}
+
+	~fa_json_atom_table()
+	{
+		for (auto& segment : segments)
+			delete[] segment.load();
+	}
+};
+
+fa_json_atom::fa_json_atom(std::string_view name)
+	: atom(fa_json_atom_table::get().intern(name))
+{
+}
+
+fa_json_atom::fa_json_atom(const std::string& name)
+	: fa_json_atom(std::string_view(name))
+{
+}
+
+fa_json_atom::fa_json_atom(const char* name)
+	: fa_json_atom(std::string_view(name))
+{
+}
+
+uint32_t fa_json_atom::id() const
+{
+	return atom;
+}
+
+std::string_view fa_json_atom::name() const
+{
+	return fa_json_atom_table::get().lookup(atom);
+}
+
+fa_json_atom::operator std::string_view() const
+{
+	return name();
+}
+
+bool fa_json_atom::operator==(const fa_json_atom& other) const
+{
+	return atom == other.atom;
+}
+
+bool fa_json_atom::operator!=(const fa_json_atom& other) const
+{
+	return atom != other.atom;
+}
+
+// Objects
+
+fa_json_object::fa_json_object(std::initializer_list<value_type> _members)
+{
+	for (const auto& member : _members)
+		insert(member);
+}
+
+size_t fa_json_object::size() const
+{
+	return members.size();
+}
+
+bool fa_json_object::empty() const
+{
+	return members.empty();
+}
+
+fa_json_object::iterator fa_json_object::begin()
+{
+	return members.begin();
+}
+
+fa_json_object::iterator fa_json_object::end()
+{
+	return members.end();
+}
+
+fa_json_object::const_iterator fa_json_object::begin() const
+{
+	return members.begin();
+}
+
+fa_json_object::const_iterator fa_json_object::end() const
+{
+	return members.end();
+}
+
+void fa_json_object::clear()
+{
+	members.clear();
+	sorted.clear();
+}
+
+void fa_json_object::reserve(size_t size)
+{
+	members.reserve(size);
+}
+
+fa_json_object::iterator fa_json_object::find(fa_json_atom key)
+{
+	return members.begin() + search(key);
+}
+
+fa_json_object::const_iterator fa_json_object::find(fa_json_atom key) const
+{
+	return members.begin() + search(key);
+}
+
+size_t fa_json_object::count(fa_json_atom key) const
+{
+	return search(key) != members.size();
+}
+
+fa_json& fa_json_object::at(fa_json_atom key)
+{
+	size_t i = search(key);
+
+	if (i == members.size())
+		throw std::out_of_range("fa_json_object::at");
+
+	return members[i].second;
+}
+
+const fa_json& fa_json_object::at(fa_json_atom key) const
+{
+	size_t i = search(key);
+
+	if (i == members.size())
+		throw std::out_of_range("fa_json_object::at");
+
+	return members[i].second;
+}
+
+fa_json& fa_json_object::operator[](fa_json_atom key)
+{
+	return insert({ key, fa_json() }).first->second;
+}
+
+std::pair<fa_json_object::iterator, bool> fa_json_object::insert(value_type member)
+{
+	size_t i = search(member.first);
+
+	if (i != members.size())
+		return { members.begin() + i, false };
+
+	members.push_back(std::move(member));
+
+	if (!sorted.empty())
+	{
+		uint32_t id = members.back().first.id();
+
+		auto position = std::upper_bound(sorted.begin(), sorted.end(), id, [this](uint32_t id, uint32_t index) {
+			return id < members[index].first.id();
+			});
+
+		sorted.insert(position, (uint32_t)i);
+	}
+	else if (members.size() > linear_limit)
+		build_index();
+
+	return { members.end() - 1, true };
+}
+
+fa_json_object::iterator fa_json_object::erase(const_iterator position)
+{
+	size_t i = position - members.cbegin();
+
+	members.erase(members.begin() + i);
+
+	sorted.clear();
+
+	if (members.size() > linear_limit)
+		build_index();
+
+	return members.begin() + i;
+}
+
+size_t fa_json_object::erase(fa_json_atom key)
+{
+	size_t i = search(key);
+
+	if (i == members.size())
+		return 0;
+
+	erase(members.cbegin() + i);
+	return 1;
+}
+
+void fa_json_object::assign(std::vector<value_type>&& _members)
+{
+	members = std::move(_members);
+	sorted.clear();
+
+	std::vector<bool> duplicate(members.size(), false);
+	bool any_duplicate = false;
+
+	if (members.size() <= linear_limit)
+	{
+		for (size_t i = 1; i < members.size(); i++)
+		{
+			for (size_t j = 0; j < i && !duplicate[i]; j++)
+				duplicate[i] = !duplicate[j] && members[i].first == members[j].first;
+
+			any_duplicate |= duplicate[i];
+		}
+	}
+	else
+	{
+		// Stable, so the first of equal keys comes first
+		build_index();
+
+		for (size_t i = 1; i < sorted.size(); i++)
+		{
+			if (members[sorted[i]].first == members[sorted[i - 1]].first)
+			{
+				duplicate[sorted[i]] = true;
+				any_duplicate = true;
+			}
+		}
+	}
+
+	if (!any_duplicate)
+		return;
+
+	size_t kept = 0;
+
+	for (size_t i = 0; i < members.size(); i++)
+	{
+		if (!duplicate[i])
+		{
+			if (kept != i)
+				members[kept] = std::move(members[i]);
+
+			kept++;
+		}
+	}
+
+	members.erase(members.begin() + kept, members.end());
+
+	sorted.clear();
+
+	if (members.size() > linear_limit)
+		build_index();
+}
+
+bool fa_json_object::operator==(const fa_json_object& other) const
+{
+	if (members.size() != other.members.size())
+		return false;
+
+	for (const auto& [key, value] : members)
+	{
+		size_t i = other.search(key);
+
+		if (i == other.members.size() || other.members[i].second != value)
+			return false;
+	}
+
+	return true;
+}
+
+bool fa_json_object::operator!=(const fa_json_object& other) const
+{
+	return !(*this == other);
+}
+
+size_t fa_json_object::search(fa_json_atom key) const
+{
+	if (sorted.empty())
+	{
+		for (size_t i = 0; i < members.size(); i++)
+		{
+			if (members[i].first == key)
+				return i;
+		}
+
+		return members.size();
+	}
+
+	auto position = std::lower_bound(sorted.begin(), sorted.end(), key.id(), [this](uint32_t index, uint32_t id) {
+		return members[index].first.id() < id;
+		});
+
+	if (position != sorted.end() && members[*position].first == key)
+		return *position;
+
+	return members.size();
+}
+
+void fa_json_object::build_index()
+{
+	sorted.resize(members.size());
+	std::iota(sorted.begin(), sorted.end(), 0);
+
+	std::stable_sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b) {
+		return members[a].first.id() < members[b].first.id();
+		});
+}
+
+fa_json_error::fa_json_error(fa_json_errno err, const std::string& desc, size_t _position, size_t _line, size_t _column)
+	: code(err), description(desc), position(_position), line(_line), column(_column)
+{
+}
+
+void fa_json_set_error(fa_json_error* err, fa_json_errno code, const std::string& description, std::string_view source, const char* at)
+{
+	err->code = code;
+	err->description = description;
+	err->position = at - source.data();
+
+	// Only computed for errors, so the parsers do not have to track lines
+	auto before = source.substr(0, err->position);
+	size_t last_newline = before.rfind('\n');
+
+	err->line = std::count(before.begin(), before.end(), '\n') + 1;
+	err->column = err->position - (last_newline == std::string_view::npos ? 0 : last_newline + 1) + 1;
 }
@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <map>
 #include <iostream>
 #include <vector>
 #include <variant>
 #include <exception>
+#include <cstdint>
 
 #define FA_JSON_INTEGER 0
 #define FA_JSON_FLOATING 1
@@ -16,35 +18,153 @@ enum class fa_json_errno
 {
 	ok,
 	unexpected_character,
-	end_of_input
+	end_of_input,
+	invalid_number,
+	number_out_of_range,
+	invalid_escape,
+	io_error,
+	too_deep,
+	out_of_memory
 };
 
 struct fa_json_error
 {
-	fa_json_error(fa_json_errno err = fa_json_errno::ok, const std::string& desc = "", std::string::const_iterator iterator = std::string::const_iterator());
+	fa_json_error(fa_json_errno err = fa_json_errno::ok, const std::string& desc = "", size_t _position = 0, size_t _line = 0, size_t _column = 0);
 
 	fa_json_errno code;
 	std::string description;
-	std::string::const_iterator it;
+
+	// Offset of the error in the parsed code and its line and column, both counted from 1
+	size_t position;
+	size_t line;
+	size_t column;
 };
 
 class fa_json;
 
-class fa_json : public std::variant<long long, long double, std::string, std::map<std::string, fa_json>, std::vector<fa_json>>
+// Interned string, compared by its 32-bit id.
+// Every name is stored once in a global table and lives until the program exits. Interning is thread-safe.
+class fa_json_atom
+{
+public:
+	fa_json_atom(std::string_view name = std::string_view());
+	fa_json_atom(const std::string& name);
+	fa_json_atom(const char* name);
+
+	uint32_t id() const;
+	std::string_view name() const;
+
+	operator std::string_view() const;
+
+	bool operator==(const fa_json_atom& other) const;
+	bool operator!=(const fa_json_atom& other) const;
+
+private:
+	uint32_t atom;
+};
+
+// Object members keyed by atoms, kept in the order they were inserted. Same interface as the std::map it replaced.
+// Small objects are searched linearly, larger ones also keep their member indices sorted by atom id.
+class fa_json_object
 {
 public:
-	using base = std::variant<long long, long double, std::string, std::map<std::string, fa_json>, std::vector<fa_json>>;
+	using key_type = fa_json_atom;
+	using mapped_type = fa_json;
+	using value_type = std::pair<fa_json_atom, fa_json>;
+	using iterator = std::vector<value_type>::iterator;
+	using const_iterator = std::vector<value_type>::const_iterator;
+
+	fa_json_object() = default;
+	fa_json_object(std::initializer_list<value_type> members);
+
+	size_t size() const;
+	bool empty() const;
+
+	iterator begin();
+	iterator end();
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	void clear();
+	void reserve(size_t size);
+
+	iterator find(fa_json_atom key);
+	const_iterator find(fa_json_atom key) const;
+	size_t count(fa_json_atom key) const;
+
+	// Throws std::out_of_range when the key is missing
+	fa_json& at(fa_json_atom key);
+	const fa_json& at(fa_json_atom key) const;
+
+	fa_json& operator[](fa_json_atom key);
+
+	// Duplicate keys keep the first value
+	std::pair<iterator, bool> insert(value_type member);
+
+	iterator erase(const_iterator position);
+	size_t erase(fa_json_atom key);
+
+	// Replaces all the members at once, dropping duplicate keys the same way insert does
+	void assign(std::vector<value_type>&& members);
+
+	// Same members with equal values, in any order
+	bool operator==(const fa_json_object& other) const;
+	bool operator!=(const fa_json_object& other) const;
+
+private:
+	static constexpr size_t linear_limit = 16;
+
+	std::vector<value_type> members;
+	std::vector<uint32_t> sorted;
+
+	// Index of the member or size() if it is missing
+	size_t search(fa_json_atom key) const;
+	void build_index();
+};
+
+class fa_json : public std::variant<int64_t, double, std::string, fa_json_object, std::vector<fa_json>>
+{
+public:
+	using base = std::variant<int64_t, double, std::string, fa_json_object, std::vector<fa_json>>;
 	using base::base;
 
 	using integer = int64_t;
-	using floating = long double;
+	using floating = double;
 	using string = std::string;
-	using object = std::map<std::string, fa_json>;
+	using object = fa_json_object;
 	using arr = std::vector<fa_json>;
 
-	void parse(const std::string& code, fa_json_error* err);
-	std::string dump() const;
+	void parse(std::string_view code, fa_json_error* err);
+
+	// Pretty output puts every element on its own line, indented with tabs.
+	// Both dumps throw std::domain_error for infinite and NaN numbers, which JSON can not represent.
+	std::string dump(bool pretty = false) const;
+
+	// Streams the text through a fixed-size buffer instead of building it in memory first
+	void dump(std::ostream& output, bool pretty = false) const;
 };
 
+// Event interface for fa_json_sax_parse. Every callback returns true to continue parsing or false to stop early.
+class fa_json_handler
+{
+public:
+	virtual ~fa_json_handler() = default;
+
+	virtual bool start_object() { return true; }
+	virtual bool key(const std::string&) { return true; }
+	virtual bool end_object() { return true; }
+
+	virtual bool start_array() { return true; }
+	virtual bool end_array() { return true; }
+
+	virtual bool string(const std::string&) { return true; }
+	virtual bool integer(fa_json::integer) { return true; }
+	virtual bool floating(fa_json::floating) { return true; }
+};
+
+// Parses the code the same way fa_json::parse does, but reports it to the handler instead of building a tree.
+// Strings passed to the handler are only valid until the callback returns.
+void fa_json_sax_parse(std::string_view code, fa_json_handler& handler, fa_json_error* err);
+
 std::istream& operator>>(std::istream& input, fa_json& output);
 std::ostream& operator<<(std::ostream& output, const fa_json& input);
\ No newline at end of file
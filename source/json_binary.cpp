@@ -0,0 +1,443 @@
+#include "json_binary.hpp"
+#include "json_scan.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// Encoding
+
+static void put_u32(std::string& out, uint32_t value)
+{
+	out.append((const char*)&value, sizeof(value));
+}
+
+static void patch_u32(std::string& out, size_t at, uint32_t value)
+{
+	std::memcpy(&out[at], &value, sizeof(value));
+}
+
+void fa_json_binary_encode(const fa_json& value, std::string& out)
+{
+	size_t start = out.size();
+
+	out.push_back((char)value.index());
+
+	switch (value.index())
+	{
+	case FA_JSON_INTEGER:
+	{
+		fa_json::integer integer = std::get<fa_json::integer>(value);
+		out.append((const char*)&integer, sizeof(integer));
+		break;
+	}
+
+	case FA_JSON_FLOATING:
+	{
+		fa_json::floating floating = std::get<fa_json::floating>(value);
+		out.append((const char*)&floating, sizeof(floating));
+		break;
+	}
+
+	case FA_JSON_STRING:
+	{
+		const auto& string = std::get<fa_json::string>(value);
+
+		put_u32(out, (uint32_t)string.size());
+		out += string;
+		break;
+	}
+
+	case FA_JSON_ARRAY:
+	{
+		const auto& arr = std::get<fa_json::arr>(value);
+
+		put_u32(out, (uint32_t)arr.size());
+
+		// Offset table, filled in as the elements are written
+		size_t table = out.size();
+		out.append(arr.size() * 4, 0);
+
+		for (size_t i = 0; i < arr.size(); i++)
+		{
+			patch_u32(out, table + i * 4, (uint32_t)(out.size() - start));
+			fa_json_binary_encode(arr[i], out);
+		}
+
+		break;
+	}
+
+	case FA_JSON_OBJECT:
+	{
+		const auto& object = std::get<fa_json::object>(value);
+
+		put_u32(out, (uint32_t)object.size());
+
+		// Key and value offset table, sorted by key for binary search
+		std::vector<const fa_json::object::value_type*> members;
+
+		for (const auto& member : object)
+			members.push_back(&member);
+
+		std::sort(members.begin(), members.end(), [](const fa_json::object::value_type* a, const fa_json::object::value_type* b) {
+			return a->first.name() < b->first.name();
+			});
+
+		size_t table = out.size();
+		out.append(object.size() * 8, 0);
+
+		for (size_t i = 0; i < members.size(); i++)
+		{
+			std::string_view key = members[i]->first.name();
+
+			patch_u32(out, table + i * 8, (uint32_t)(out.size() - start));
+			put_u32(out, (uint32_t)key.size());
+			out += key;
+
+			patch_u32(out, table + i * 8 + 4, (uint32_t)(out.size() - start));
+			fa_json_binary_encode(members[i]->second, out);
+		}
+
+		break;
+	}
+	}
+}
+
+// Reading. Every read is bounds checked, so a damaged cache can not read outside of its buffer.
+
+fa_json_binary::fa_json_binary(const void* _data, const void* _end)
+	: data((const unsigned char*)_data), end((const unsigned char*)_end)
+{
+	if (!data || data >= end)
+		data = end = 0;
+}
+
+fa_json_binary::operator bool() const
+{
+	return data != 0;
+}
+
+size_t fa_json_binary::index() const
+{
+	return data ? *data : FA_JSON_OBJECT;
+}
+
+bool fa_json_binary::read(size_t offset, void* out, size_t size) const
+{
+	size_t available = end - data;
+
+	if (!data || size > available || offset > available - size)
+		return false;
+
+	std::memcpy(out, data + offset, size);
+	return true;
+}
+
+uint32_t fa_json_binary::read_u32(size_t offset) const
+{
+	uint32_t ret = 0;
+	read(offset, &ret, sizeof(ret));
+
+	return ret;
+}
+
+fa_json::integer fa_json_binary::get_integer() const
+{
+	fa_json::integer ret = 0;
+
+	if (index() == FA_JSON_INTEGER)
+		read(1, &ret, sizeof(ret));
+
+	return ret;
+}
+
+fa_json::floating fa_json_binary::get_floating() const
+{
+	fa_json::floating ret = 0;
+
+	if (index() == FA_JSON_FLOATING)
+		read(1, &ret, sizeof(ret));
+
+	return ret;
+}
+
+std::string_view fa_json_binary::get_string() const
+{
+	if (!data || index() != FA_JSON_STRING)
+		return std::string_view();
+
+	uint32_t length = read_u32(1);
+
+	if (length > (size_t)(end - data) - 5)
+		return std::string_view();
+
+	return std::string_view((const char*)data + 5, length);
+}
+
+size_t fa_json_binary::size() const
+{
+	if (!data || (index() != FA_JSON_ARRAY && index() != FA_JSON_OBJECT))
+		return 0;
+
+	return read_u32(1);
+}
+
+fa_json_binary fa_json_binary::at_offset(size_t table_entry) const
+{
+	uint32_t offset = read_u32(table_entry);
+
+	if (!offset || offset >= (size_t)(end - data))
+		return fa_json_binary();
+
+	return fa_json_binary(data + offset, end);
+}
+
+fa_json_binary fa_json_binary::operator[](size_t i) const
+{
+	if (index() != FA_JSON_ARRAY || i >= size())
+		return fa_json_binary();
+
+	return at_offset(5 + i * 4);
+}
+
+std::string_view fa_json_binary::key(size_t i) const
+{
+	if (index() != FA_JSON_OBJECT || i >= size())
+		return std::string_view();
+
+	uint32_t offset = read_u32(5 + i * 8);
+	uint32_t length = read_u32(offset);
+
+	if (!offset || (size_t)offset + 4 + length > (size_t)(end - data))
+		return std::string_view();
+
+	return std::string_view((const char*)data + offset + 4, length);
+}
+
+fa_json_binary fa_json_binary::value(size_t i) const
+{
+	if (index() != FA_JSON_OBJECT || i >= size())
+		return fa_json_binary();
+
+	return at_offset(5 + i * 8 + 4);
+}
+
+fa_json_binary fa_json_binary::find(std::string_view search) const
+{
+	if (index() != FA_JSON_OBJECT)
+		return fa_json_binary();
+
+	size_t low = 0;
+	size_t high = size();
+
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		int comparison = key(middle).compare(search);
+
+		if (comparison == 0)
+			return value(middle);
+		else if (comparison < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return fa_json_binary();
+}
+
+fa_json fa_json_binary::to_json() const
+{
+	switch (index())
+	{
+	case FA_JSON_INTEGER:
+		return get_integer();
+
+	case FA_JSON_FLOATING:
+		return get_floating();
+
+	case FA_JSON_STRING:
+		return std::string(get_string());
+
+	case FA_JSON_ARRAY:
+	{
+		fa_json::arr ret;
+		size_t count = size();
+
+		for (size_t i = 0; i < count; i++)
+			ret.push_back((*this)[i].to_json());
+
+		return ret;
+	}
+
+	default:
+	{
+		std::vector<fa_json::object::value_type> members;
+		size_t count = size();
+
+		for (size_t i = 0; i < count; i++)
+			members.emplace_back(key(i), value(i).to_json());
+
+		fa_json::object ret;
+		ret.assign(std::move(members));
+
+		return ret;
+	}
+	}
+}
+
+// Cache
+
+struct fa_json_cache_header
+{
+	char magic[4];
+	uint32_t format_version;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint64_t source_hash;
+};
+
+static const char cache_magic[4] = { 'F', 'A', 'J', 'B' };
+static const uint32_t cache_format_version = 1;
+
+static void write_cache(const std::filesystem::path& path, const std::string& encoded)
+{
+	// Written next to the final file and renamed, so a reader never sees half of it
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		if (!file.write(encoded.data(), encoded.size()))
+			return;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+
+	if (ec)
+		std::filesystem::remove(temporary, ec);
+}
+
+bool fa_json_cache::load(const std::filesystem::path& source, fa_json_error* err)
+{
+	cache_file.close();
+	encoded.clear();
+	cached = false;
+
+	std::error_code ec;
+	uint64_t source_size = std::filesystem::file_size(source, ec);
+	int64_t source_mtime = ec ? 0 : (int64_t)std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+
+	if (ec)
+	{
+		if (err)
+			*err = fa_json_error(fa_json_errno::io_error, "Could not read the file.");
+
+		return false;
+	}
+
+	std::filesystem::path path = cache_path(source);
+	fa_FileBuffer source_file;
+
+	fa_json_cache_header header;
+	bool source_read = false;
+
+	if (cache_file.open(path) && cache_file.view().size() > sizeof(header))
+	{
+		std::memcpy(&header, cache_file.view().data(), sizeof(header));
+
+		if (!std::memcmp(header.magic, cache_magic, 4) && header.format_version == cache_format_version && header.source_size == source_size)
+		{
+			if (header.source_mtime == source_mtime)
+			{
+				cached = true;
+
+				if (err)
+					*err = fa_json_error();
+
+				return true;
+			}
+
+			// Touched, but possibly not changed
+			source_read = source_file.open(source);
+
+			if (source_read && fa_util::hash(source_file.view()) == header.source_hash)
+			{
+				header.source_mtime = source_mtime;
+
+				encoded.assign(cache_file.view().data(), cache_file.view().size());
+				std::memcpy(&encoded[0], &header, sizeof(header));
+
+				cache_file.close();
+				write_cache(path, encoded);
+
+				cached = true;
+
+				if (err)
+					*err = fa_json_error();
+
+				return true;
+			}
+		}
+	}
+
+	cache_file.close();
+
+	if (!source_read && !source_file.open(source))
+	{
+		if (err)
+			*err = fa_json_error(fa_json_errno::io_error, "Could not read the file.");
+
+		return false;
+	}
+
+	fa_json value;
+	fa_json_error error;
+
+	value.parse(source_file.view(), &error);
+
+	if (err)
+		*err = error;
+
+	if (error.code != fa_json_errno::ok)
+		return false;
+
+	std::memcpy(header.magic, cache_magic, 4);
+	header.format_version = cache_format_version;
+	header.source_size = source_size;
+	header.source_mtime = source_mtime;
+	header.source_hash = fa_util::hash(source_file.view());
+
+	encoded.assign((const char*)&header, sizeof(header));
+	fa_json_binary_encode(value, encoded);
+
+	write_cache(path, encoded);
+
+	return true;
+}
+
+fa_json_binary fa_json_cache::root() const
+{
+	std::string_view view = cached && cache_file.view().size() ? cache_file.view() : std::string_view(encoded);
+
+	if (view.size() <= sizeof(fa_json_cache_header))
+		return fa_json_binary();
+
+	return fa_json_binary(view.data() + sizeof(fa_json_cache_header), view.data() + view.size());
+}
+
+bool fa_json_cache::from_cache() const
+{
+	return cached;
+}
+
+std::filesystem::path fa_json_cache::cache_path(const std::filesystem::path& source)
+{
+	std::filesystem::path ret = source;
+	ret += ".fabin";
+
+	return ret;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "json.hpp"
+#include "FileBuffer.hpp"
+
+#include <string_view>
+#include <filesystem>
+
+// Compact binary encoding of fa_json.
+// Every value starts with its FA_JSON_* type byte. Numbers are stored as 8 bytes and strings as a 32-bit length and the bytes.
+// Arrays and objects store their element count and a table of 32-bit offsets (objects also of keys, sorted),
+// so a reader can jump straight to any element or binary search a key without decoding its siblings.
+// Integers are stored in the byte order of the host, the encoding is only a local cache and never moves between machines.
+
+// Appends the encoded value to out
+void fa_json_binary_encode(const fa_json& value, std::string& out);
+
+// Read-only view of an encoded value. Views of missing or malformed values are empty (false).
+class fa_json_binary
+{
+public:
+	fa_json_binary(const void* data = 0, const void* end = 0);
+
+	explicit operator bool() const;
+
+	// One of FA_JSON_* values, same as fa_json::index()
+	size_t index() const;
+
+	fa_json::integer get_integer() const;
+	fa_json::floating get_floating() const;
+	std::string_view get_string() const;
+
+	// Number of elements of an array or members of an object
+	size_t size() const;
+
+	fa_json_binary operator[](size_t i) const;
+
+	std::string_view key(size_t i) const;
+	fa_json_binary value(size_t i) const;
+	fa_json_binary find(std::string_view key) const;
+
+	// Decodes the whole value
+	fa_json to_json() const;
+
+private:
+	const unsigned char* data;
+	const unsigned char* end;
+
+	bool read(size_t offset, void* out, size_t size) const;
+	uint32_t read_u32(size_t offset) const;
+
+	// Value at the offset stored in the table entry, relative to this value
+	fa_json_binary at_offset(size_t table_entry) const;
+};
+
+// A JSON text file together with its binary encoding cached next to it as <file>.fabin.
+// The cache stores the source's size, modification time and content hash. When size and time still match,
+// the source is not read at all. When only the time changed, the source is hashed and the cache reused if the content is the same.
+class fa_json_cache
+{
+public:
+	// Loads the document, parsing the source and rewriting the cache only if it is missing or stale.
+	// Failing to write the cache (e.g. read-only directory) is not an error.
+	bool load(const std::filesystem::path& source, fa_json_error* err);
+
+	fa_json_binary root() const;
+
+	// Whether the last load was served from the cache
+	bool from_cache() const;
+
+	static std::filesystem::path cache_path(const std::filesystem::path& source);
+
+private:
+	fa_FileBuffer cache_file;
+	std::string encoded;
+	bool cached = false;
+};
@@ -0,0 +1,540 @@
+#include "json_document.hpp"
+#include "json_scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+size_t fa_json_node::index() const
+{
+	return type;
+}
+
+fa_json::integer fa_json_node::get_integer() const
+{
+	return integer;
+}
+
+fa_json::floating fa_json_node::get_floating() const
+{
+	return floating;
+}
+
+std::string_view fa_json_node::get_string() const
+{
+	return std::string_view(string, length);
+}
+
+size_t fa_json_node::size() const
+{
+	return type == FA_JSON_ARRAY || type == FA_JSON_OBJECT ? length : 0;
+}
+
+const fa_json_node* fa_json_node::begin_elements() const
+{
+	return elements;
+}
+
+const fa_json_node* fa_json_node::end_elements() const
+{
+	return elements + length;
+}
+
+const fa_json_node& fa_json_node::operator[](size_t i) const
+{
+	return elements[i];
+}
+
+const fa_json_member* fa_json_node::begin_members() const
+{
+	return members;
+}
+
+const fa_json_member* fa_json_node::end_members() const
+{
+	return members + length;
+}
+
+const fa_json_node* fa_json_node::find(std::string_view key) const
+{
+	if (type != FA_JSON_OBJECT)
+		return 0;
+
+	auto it = std::lower_bound(begin_members(), end_members(), key, [](const fa_json_member& member, std::string_view key) -> bool {
+		return member.key() < key;
+		});
+
+	if (it != end_members() && it->key() == key)
+		return &it->value;
+
+	return 0;
+}
+
+fa_json fa_json_node::to_json() const
+{
+	switch (type)
+	{
+	case FA_JSON_INTEGER:
+		return integer;
+
+	case FA_JSON_FLOATING:
+		return floating;
+
+	case FA_JSON_STRING:
+		return std::string(get_string());
+
+	case FA_JSON_ARRAY:
+	{
+		fa_json::arr ret;
+		ret.reserve(length);
+
+		for (auto it = begin_elements(); it != end_elements(); it++)
+			ret.push_back(it->to_json());
+
+		return ret;
+	}
+
+	default:
+	{
+		std::vector<fa_json::object::value_type> members;
+
+		for (auto it = begin_members(); it != end_members(); it++)
+			members.emplace_back(it->key(), it->value.to_json());
+
+		fa_json::object ret;
+		ret.assign(std::move(members));
+
+		return ret;
+	}
+	}
+}
+
+std::string_view fa_json_member::key() const
+{
+	return std::string_view(key_data, key_length);
+}
+
+// Walks the code once to find how much arena memory the document can need at most.
+// Every array element and object member is preceded by '[', '{' or ',', and only strings with escapes are copied.
+static size_t estimate_arena_size(std::string_view code)
+{
+	size_t slots = 0;
+	size_t containers = 0;
+	size_t escaped = 0;
+
+	bool in_string = false;
+	bool has_escape = false;
+	size_t string_start = 0;
+
+	for (size_t i = 0; i < code.size(); i++)
+	{
+		char c = code[i];
+
+		if (in_string)
+		{
+			if (c == '\\')
+			{
+				has_escape = true;
+				i++;
+			}
+			else if (c == '"')
+			{
+				in_string = false;
+
+				if (has_escape)
+					escaped += i - string_start;
+			}
+		}
+		else if (c == '"')
+		{
+			in_string = true;
+			has_escape = false;
+			string_start = i;
+		}
+		else if (c == '[' || c == '{')
+		{
+			slots++;
+			containers++;
+		}
+		else if (c == ',')
+			slots++;
+	}
+
+	if (in_string && has_escape)
+		escaped += code.size() - string_start;
+
+	// Every container allocation can waste up to its alignment for padding
+	return slots * sizeof(fa_json_member) + containers * alignof(fa_json_member) + escaped;
+}
+
+class fa_json_document_parser
+{
+public:
+	fa_json_document_parser(fa_json_document& _document, std::string_view _code, fa_json_error* _err)
+		: document(_document), code(_code), it(_code.data()), end(_code.data() + _code.size()), err(_err)
+	{
+	}
+
+	void parse(fa_json_node& ret)
+	{
+		await_character(0, false);
+
+		// Empty input is an empty object, same as in fa_json::parse
+		if (it == end)
+			ret = fa_json_node();
+		else if (parse_value(ret) && await_character(0, false) && it != end)
+			set_error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' after the end of the document.");
+	}
+
+private:
+	fa_json_document& document;
+	std::string_view code;
+
+	const char* it;
+	const char* end;
+
+	fa_json_error* err;
+
+	// Nesting of the value being parsed
+	size_t depth = 0;
+
+	// Elements of the containers that are being parsed. They are copied into the arena when the container ends.
+	std::vector<fa_json_node> element_stack;
+	std::vector<fa_json_member> member_stack;
+
+	void set_error(fa_json_errno code_, const std::string& description)
+	{
+		fa_json_set_error(err, code_, description, code, it);
+	}
+
+	bool arena_exhausted()
+	{
+		set_error(fa_json_errno::out_of_memory, "The document arena is exhausted.");
+		return false;
+	}
+
+	bool await_character(const char c, bool eoi_on_end)
+	{
+		it = fa_json_skip_whitespace(it, end);
+
+		if (it == end)
+		{
+			if (eoi_on_end)
+			{
+				set_error(fa_json_errno::end_of_input, "End of input when looking for '" + (c ? std::string(1, c) : "non-whitespace character") + "'.");
+				return false;
+			}
+		}
+		else if (c && *it != c)
+		{
+			set_error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when looking for '" + std::string(1, c) + "'.");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool parse_string(const char*& data, size_t& length)
+	{
+		const char* start = it;
+		bool has_escape = false;
+
+		while (true)
+		{
+			it = fa_json_find_string_special(it, end);
+
+			if (it == end || *it == '"')
+				break;
+
+			// Skip the backslash and the escaped character
+			has_escape = true;
+
+			if (++it == end)
+				break;
+
+			it++;
+		}
+
+		if (it == end)
+		{
+			set_error(fa_json_errno::end_of_input, "Unexpected end of input when parsing a string.");
+			return false;
+		}
+
+		if (has_escape)
+		{
+			// Decoded escapes are never longer than their source
+			char* out = (char*)document.allocate(it - start, 1);
+
+			if (!out)
+				return arena_exhausted();
+
+			length = 0;
+
+			for (const char* c = start; c != it;)
+			{
+				if (*c != '\\')
+				{
+					out[length++] = *c++;
+					continue;
+				}
+
+				fa_json_errno error = fa_json_errno::ok;
+				size_t decoded = fa_json_decode_escape(++c, it, out + length, error);
+
+				if (!decoded)
+				{
+					const char* string_end = it;
+					it = c;
+					set_error(fa_json_errno::invalid_escape, "Invalid escape sequence when parsing a string.");
+					it = string_end;
+					return false;
+				}
+
+				length += decoded;
+			}
+
+			data = out;
+		}
+		else
+		{
+			data = start;
+			length = it - start;
+		}
+
+		it++;
+
+		return true;
+	}
+
+	bool parse_object(fa_json_node& ret)
+	{
+		size_t start = member_stack.size();
+
+		while (true)
+		{
+			// Wait for string
+			if (!await_character(0, true))
+				return false;
+
+			if (*it == '}')
+				break;
+
+			if (*it != '"')
+			{
+				set_error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing object.");
+				return false;
+			}
+
+			fa_json_member member;
+			it++;
+
+			if (!parse_string(member.key_data, member.key_length))
+				return false;
+
+			// Wait for :
+			if (!await_character(':', true))
+				return false;
+
+			it++;
+
+			if (!parse_value(member.value))
+				return false;
+
+			member_stack.push_back(member);
+
+			if (!await_character(0, true))
+				return false;
+
+			if (*it == ',')
+				it++;
+			else if (*it == '}')
+				break;
+			else
+			{
+				set_error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing object.");
+				return false;
+			}
+		}
+
+		it++;
+
+		// Sort for binary search. Duplicate keys keep the first value, same as fa_json::object.
+		auto first = member_stack.begin() + start;
+
+		std::stable_sort(first, member_stack.end(), [](const fa_json_member& a, const fa_json_member& b) -> bool {
+			return a.key() < b.key();
+			});
+
+		auto last = std::unique(first, member_stack.end(), [](const fa_json_member& a, const fa_json_member& b) -> bool {
+			return a.key() == b.key();
+			});
+
+		size_t count = last - first;
+		fa_json_member* members = (fa_json_member*)document.allocate(count * sizeof(fa_json_member), alignof(fa_json_member));
+
+		if (!members)
+			return arena_exhausted();
+
+		std::copy(first, last, members);
+		member_stack.resize(start);
+
+		ret.type = FA_JSON_OBJECT;
+		ret.length = count;
+		ret.members = members;
+
+		return true;
+	}
+
+	bool parse_array(fa_json_node& ret)
+	{
+		size_t start = element_stack.size();
+
+		while (true)
+		{
+			if (!await_character(0, true))
+				return false;
+
+			if (*it == ']')
+				break;
+
+			fa_json_node value;
+
+			if (!parse_value(value))
+				return false;
+
+			element_stack.push_back(value);
+
+			if (!await_character(0, true))
+				return false;
+
+			if (*it == ',')
+				it++;
+			else if (*it == ']')
+				break;
+			else
+			{
+				set_error(fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "' when parsing array.");
+				return false;
+			}
+		}
+
+		it++;
+
+		size_t count = element_stack.size() - start;
+		fa_json_node* elements = (fa_json_node*)document.allocate(count * sizeof(fa_json_node), alignof(fa_json_node));
+
+		if (!elements)
+			return arena_exhausted();
+
+		std::copy(element_stack.begin() + start, element_stack.end(), elements);
+		element_stack.resize(start);
+
+		ret.type = FA_JSON_ARRAY;
+		ret.length = count;
+		ret.elements = elements;
+
+		return true;
+	}
+
+	bool parse_value(fa_json_node& ret)
+	{
+		if (!await_character(0, true))
+			return false;
+
+		switch (*it)
+		{
+		case '{':
+		case '[':
+		{
+			if (++depth > FA_JSON_MAX_DEPTH)
+			{
+				set_error(fa_json_errno::too_deep, "Objects and arrays are nested too deep.");
+				return false;
+			}
+
+			bool parsed = *it++ == '{' ? parse_object(ret) : parse_array(ret);
+			depth--;
+
+			return parsed;
+		}
+
+		case '"':
+			it++;
+			ret.type = FA_JSON_STRING;
+			return parse_string(ret.string, ret.length);
+
+		default:
+			if ((*it >= '0' && *it <= '9') || *it == '.' || *it == '-')
+			{
+				fa_json_number number;
+				fa_json_errno error = fa_json_errno::ok;
+				const char* number_end = fa_json_parse_number(it, end, number, error);
+
+				if (error != fa_json_errno::ok)
+				{
+					set_error(error, error == fa_json_errno::number_out_of_range ? "Number out of range." : "Invalid number.");
+					return false;
+				}
+
+				if (number.is_floating)
+				{
+					ret.type = FA_JSON_FLOATING;
+					ret.floating = number.floating;
+				}
+				else
+				{
+					ret.type = FA_JSON_INTEGER;
+					ret.integer = number.integer;
+				}
+
+				it = number_end;
+				return true;
+			}
+
+			set_error(fa_json_errno::unexpected_character, "Unexpected character " + std::string(1, *it) + ".");
+			return false;
+		}
+	}
+};
+
+void fa_json_document::parse(std::string_view code, fa_json_error* err)
+{
+	// The whole arena is allocated up front, so freeing the document is a single deallocation
+	capacity = estimate_arena_size(code);
+	used = 0;
+	arena.reset(capacity ? new unsigned char[capacity] : 0);
+	root_node = fa_json_node();
+
+	fa_json_error error;
+
+	fa_json_document_parser parser(*this, code, &error);
+	parser.parse(root_node);
+
+	if (error.code != fa_json_errno::ok)
+		root_node = fa_json_node();
+
+	if (err)
+		*err = error;
+}
+
+const fa_json_node& fa_json_document::root() const
+{
+	return root_node;
+}
+
+size_t fa_json_document::arena_size() const
+{
+	return capacity;
+}
+
+void* fa_json_document::allocate(size_t size, size_t alignment)
+{
+	size_t offset = (used + alignment - 1) & ~(alignment - 1);
+
+	if (offset + size > capacity)
+		return 0;
+
+	used = offset + size;
+
+	return arena.get() + offset;
+}
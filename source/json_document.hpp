@@ -0,0 +1,93 @@
+#pragma once
+#include "json.hpp"
+
+#include <string_view>
+#include <memory>
+
+struct fa_json_member;
+
+// Read-only JSON value stored in a fa_json_document's arena.
+// Strings and keys point either into the parsed code or into the arena, so nodes are only valid as long as both live.
+class fa_json_node
+{
+public:
+	// One of FA_JSON_* values, same as fa_json::index()
+	size_t index() const;
+
+	fa_json::integer get_integer() const;
+	fa_json::floating get_floating() const;
+	std::string_view get_string() const;
+
+	// Number of elements of an array or members of an object
+	size_t size() const;
+
+	// Arrays
+	const fa_json_node* begin_elements() const;
+	const fa_json_node* end_elements() const;
+	const fa_json_node& operator[](size_t i) const;
+
+	// Objects. Members are sorted by key.
+	const fa_json_member* begin_members() const;
+	const fa_json_member* end_members() const;
+	const fa_json_node* find(std::string_view key) const;
+
+	// Deep copy into an owning value
+	fa_json to_json() const;
+
+private:
+	friend class fa_json_document;
+	friend class fa_json_document_parser;
+
+	uint8_t type = FA_JSON_OBJECT;
+	size_t length = 0;
+
+	union
+	{
+		fa_json::integer integer;
+		fa_json::floating floating;
+		const char* string;
+		const fa_json_node* elements;
+		const fa_json_member* members = 0;
+	};
+};
+
+struct fa_json_member
+{
+	const char* key_data;
+	size_t key_length;
+	fa_json_node value;
+
+	std::string_view key() const;
+};
+
+// A JSON document whose nodes all live in one bump arena.
+// Strings without escapes are not copied, they point into the parsed code, which has to outlive the document.
+class fa_json_document
+{
+public:
+	fa_json_document() = default;
+	fa_json_document(const fa_json_document&) = delete;
+	fa_json_document(fa_json_document&&) = default;
+
+	fa_json_document& operator=(const fa_json_document&) = delete;
+	fa_json_document& operator=(fa_json_document&&) = default;
+
+	void parse(std::string_view code, fa_json_error* err);
+
+	const fa_json_node& root() const;
+
+	// Bytes reserved for the arena
+	size_t arena_size() const;
+
+private:
+	std::unique_ptr<unsigned char[]> arena;
+	size_t capacity = 0;
+	size_t used = 0;
+
+	fa_json_node root_node;
+
+	friend class fa_json_document_parser;
+
+	// Null when the arena is exhausted, which the size estimate should never allow
+	void* allocate(size_t size, size_t alignment);
+};
@@ -0,0 +1,463 @@
+#include "json_lazy.hpp"
+#include "json_scan.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <unordered_set>
+
+// End of the string starting at the quote it, or 0 if it is not closed before end
+static const char* skip_string(const char* it, const char* end)
+{
+	it++;
+
+	while (true)
+	{
+		it = fa_json_find_string_special(it, end);
+
+		if (it == end)
+			return 0;
+
+		if (*it == '"')
+			return it + 1;
+
+		// Escaped character, whatever it is
+		if (++it == end)
+			return 0;
+
+		it++;
+	}
+}
+
+// Decodes the contents of a string (without the quotes)
+static bool decode_string(std::string_view raw, std::string& out)
+{
+	const char* it = raw.data();
+	const char* end = raw.data() + raw.size();
+
+	out.clear();
+
+	while (true)
+	{
+		const char* special = fa_json_find_string_special(it, end);
+		out.append(it, special);
+		it = special;
+
+		if (it == end)
+			return true;
+
+		char decoded[4];
+		fa_json_errno error = fa_json_errno::ok;
+		size_t length = fa_json_decode_escape(++it, end, decoded, error);
+
+		if (!length)
+			return false;
+
+		out.append(decoded, length);
+	}
+}
+
+static bool key_equals(std::string_view raw, std::string_view key)
+{
+	// Keys are almost never escaped, so they are compared in place
+	if (raw.find('\\') == std::string_view::npos)
+		return raw == key;
+
+	std::string decoded;
+	return decode_string(raw, decoded) && decoded == key;
+}
+
+static bool is_scalar_end(char c)
+{
+	return fa_json_is_whitespace(c) || c == ',' || c == ':' || c == '}' || c == ']' || c == '{' || c == '[' || c == '"';
+}
+
+fa_json_lazy_value::fa_json_lazy_value(const fa_json_lazy* _document, const char* _begin, const char* _end)
+	: document(_document), begin(_begin), end(_end)
+{
+}
+
+fa_json_lazy_value::operator bool() const
+{
+	return document != 0;
+}
+
+size_t fa_json_lazy_value::index() const
+{
+	if (!document)
+		return FA_JSON_OBJECT;
+
+	switch (*begin)
+	{
+	case '{':
+		return FA_JSON_OBJECT;
+
+	case '[':
+		return FA_JSON_ARRAY;
+
+	case '"':
+		return FA_JSON_STRING;
+	}
+
+	if (*begin == '-' || *begin == '.' || (*begin >= '0' && *begin <= '9'))
+		return std::find_if(begin, end, [](char c) { return c == '.' || c == 'e' || c == 'E'; }) != end ? FA_JSON_FLOATING : FA_JSON_INTEGER;
+
+	return FA_JSON_LAZY_OTHER;
+}
+
+std::string_view fa_json_lazy_value::raw() const
+{
+	return document ? std::string_view(begin, end - begin) : std::string_view();
+}
+
+fa_json fa_json_lazy_value::decode(fa_json_error* err) const
+{
+	fa_json ret;
+	fa_json_error error;
+
+	if (!document)
+		error = fa_json_error(fa_json_errno::end_of_input, "Value does not exist.");
+	else
+	{
+		ret.parse(raw(), &error);
+
+		// Reported relative to the whole document
+		if (error.code != fa_json_errno::ok)
+			fa_json_set_error(&error, error.code, error.description, document->code, begin + error.position);
+	}
+
+	if (err)
+		*err = error;
+
+	return ret;
+}
+
+fa_json::integer fa_json_lazy_value::get_integer() const
+{
+	fa_json_number number;
+	fa_json_errno error = fa_json_errno::ok;
+
+	if (!document || fa_json_parse_number(begin, end, number, error) != end || error != fa_json_errno::ok || number.is_floating)
+		return 0;
+
+	return number.integer;
+}
+
+fa_json::floating fa_json_lazy_value::get_floating() const
+{
+	fa_json_number number;
+	fa_json_errno error = fa_json_errno::ok;
+
+	if (!document || fa_json_parse_number(begin, end, number, error) != end || error != fa_json_errno::ok || !number.is_floating)
+		return 0;
+
+	return number.floating;
+}
+
+std::string fa_json_lazy_value::get_string() const
+{
+	std::string ret;
+
+	if (!document || *begin != '"' || !decode_string(std::string_view(begin + 1, end - begin - 2), ret))
+		ret.clear();
+
+	return ret;
+}
+
+template<typename F>
+void fa_json_lazy_value::for_each(F callback) const
+{
+	if (!document || (*begin != '{' && *begin != '['))
+		return;
+
+	bool is_object = *begin == '{';
+
+	const char* it = begin + 1;
+	const char* last = end - 1;
+
+	while (true)
+	{
+		it = fa_json_skip_whitespace(it, last);
+
+		if (it == last)
+			return;
+
+		std::string_view key;
+
+		if (is_object)
+		{
+			const char* key_end = *it == '"' ? skip_string(it, last) : 0;
+
+			if (!key_end)
+				return;
+
+			key = std::string_view(it + 1, key_end - it - 2);
+			it = fa_json_skip_whitespace(key_end, last);
+
+			if (it == last || *it != ':')
+				return;
+
+			it = fa_json_skip_whitespace(it + 1, last);
+		}
+
+		const char* value_end = document->skip_value(it, last);
+
+		if (!value_end || !callback(key, fa_json_lazy_value(document, it, value_end)))
+			return;
+
+		it = fa_json_skip_whitespace(value_end, last);
+
+		if (it == last || *it != ',')
+			return;
+
+		it++;
+	}
+}
+
+fa_json_lazy_value fa_json_lazy_value::find(std::string_view key) const
+{
+	fa_json_lazy_value ret;
+
+	if (index() == FA_JSON_OBJECT)
+	{
+		for_each([&](std::string_view raw_key, const fa_json_lazy_value& value) {
+			if (!key_equals(raw_key, key))
+				return true;
+
+			ret = value;
+			return false;
+			});
+	}
+
+	return ret;
+}
+
+fa_json_lazy_value fa_json_lazy_value::operator[](size_t i) const
+{
+	fa_json_lazy_value ret;
+
+	if (index() == FA_JSON_ARRAY)
+	{
+		for_each([&](std::string_view, const fa_json_lazy_value& value) {
+			if (i--)
+				return true;
+
+			ret = value;
+			return false;
+			});
+	}
+
+	return ret;
+}
+
+fa_json_lazy_value fa_json_lazy_value::at(std::string_view pointer) const
+{
+	fa_json_lazy_value current = *this;
+
+	while (!pointer.empty() && current)
+	{
+		if (pointer[0] != '/')
+			return fa_json_lazy_value();
+
+		size_t token_end = pointer.find('/', 1);
+		std::string_view raw_token = pointer.substr(1, token_end == std::string_view::npos ? std::string_view::npos : token_end - 1);
+
+		pointer = token_end == std::string_view::npos ? std::string_view() : pointer.substr(token_end);
+
+		// ~1 is '/' and ~0 is '~'
+		std::string token;
+
+		for (size_t i = 0; i < raw_token.size(); i++)
+		{
+			if (raw_token[i] == '~' && i + 1 < raw_token.size() && (raw_token[i + 1] == '0' || raw_token[i + 1] == '1'))
+			{
+				token.push_back(raw_token[++i] == '0' ? '~' : '/');
+			}
+			else
+				token.push_back(raw_token[i]);
+		}
+
+		if (current.index() == FA_JSON_ARRAY)
+		{
+			size_t i = 0;
+			auto result = std::from_chars(token.data(), token.data() + token.size(), i);
+
+			if (token.empty() || result.ec != std::errc() || result.ptr != token.data() + token.size() || (token[0] == '0' && token.size() > 1))
+				return fa_json_lazy_value();
+
+			current = current[i];
+		}
+		else
+			current = current.find(token);
+	}
+
+	return current;
+}
+
+std::vector<fa_json_lazy_value> fa_json_lazy_value::elements() const
+{
+	std::vector<fa_json_lazy_value> ret;
+
+	if (index() == FA_JSON_ARRAY)
+	{
+		for_each([&](std::string_view, const fa_json_lazy_value& value) {
+			ret.push_back(value);
+			return true;
+			});
+	}
+
+	return ret;
+}
+
+std::vector<std::pair<std::string, fa_json_lazy_value>> fa_json_lazy_value::members() const
+{
+	std::vector<std::pair<std::string, fa_json_lazy_value>> ret;
+
+	if (index() == FA_JSON_OBJECT)
+	{
+		std::string key;
+		std::unordered_set<std::string> seen;
+
+		for_each([&](std::string_view raw_key, const fa_json_lazy_value& value) {
+			if (decode_string(raw_key, key) && seen.insert(key).second)
+				ret.push_back({ key, value });
+
+			return true;
+			});
+	}
+
+	return ret;
+}
+
+void fa_json_lazy::parse(std::string_view _code, fa_json_error* err)
+{
+	fa_json_error error;
+
+	code = _code;
+	containers.clear();
+
+	const char* it = code.data();
+	const char* end = code.data() + code.size();
+
+	// Empty input is an empty object, same as the other parsers
+	if (fa_json_skip_whitespace(it, end) == end)
+	{
+		code = "{}";
+		containers.push_back({ 0, 1 });
+
+		if (err)
+			*err = error;
+
+		return;
+	}
+
+	// Checks the whole grammar, the index pass below only looks at strings and brackets
+	fa_json_handler validator;
+	fa_json_sax_parse(code, validator, &error);
+
+	if (error.code != fa_json_errno::ok)
+	{
+		code = std::string_view();
+
+		if (err)
+			*err = error;
+
+		return;
+	}
+
+	std::vector<size_t> open;
+
+	while (it != end)
+	{
+		if (*it == '"')
+		{
+			const char* string_end = skip_string(it, end);
+
+			if (!string_end)
+			{
+				fa_json_set_error(&error, fa_json_errno::end_of_input, "Unexpected end of input when parsing a string.", code, end);
+				break;
+			}
+
+			it = string_end;
+			continue;
+		}
+
+		if (*it == '{' || *it == '[')
+		{
+			open.push_back(containers.size());
+			containers.push_back({ it - code.data(), 0 });
+		}
+		else if (*it == '}' || *it == ']')
+		{
+			if (open.empty() || code[containers[open.back()].first] != (*it == '}' ? '{' : '['))
+			{
+				fa_json_set_error(&error, fa_json_errno::unexpected_character, "Unexpected character '" + std::string(1, *it) + "'.", code, it);
+				break;
+			}
+
+			containers[open.back()].second = it - code.data();
+			open.pop_back();
+		}
+
+		it++;
+	}
+
+	if (error.code == fa_json_errno::ok && !open.empty())
+		fa_json_set_error(&error, fa_json_errno::end_of_input, "End of input when looking for '" + std::string(1, code[containers[open.back()].first] == '{' ? '}' : ']') + "'.", code, end);
+
+	if (error.code != fa_json_errno::ok)
+	{
+		code = std::string_view();
+		containers.clear();
+	}
+
+	if (err)
+		*err = error;
+}
+
+fa_json_lazy_value fa_json_lazy::root() const
+{
+	const char* end = code.data() + code.size();
+	const char* begin = fa_json_skip_whitespace(code.data(), end);
+	const char* value_end = begin != end ? skip_value(begin, end) : 0;
+
+	if (!value_end)
+		return fa_json_lazy_value();
+
+	return fa_json_lazy_value(this, begin, value_end);
+}
+
+fa_json_lazy_value fa_json_lazy::at(std::string_view pointer) const
+{
+	return root().at(pointer);
+}
+
+const char* fa_json_lazy::skip_value(const char* it, const char* end) const
+{
+	if (it == end)
+		return 0;
+
+	if (*it == '{' || *it == '[')
+	{
+		size_t offset = it - code.data();
+
+		auto container = std::lower_bound(containers.begin(), containers.end(), offset, [](const std::pair<size_t, size_t>& c, size_t o) {
+			return c.first < o;
+			});
+
+		if (container == containers.end() || container->first != offset || code.data() + container->second >= end)
+			return 0;
+
+		return code.data() + container->second + 1;
+	}
+
+	if (*it == '"')
+		return skip_string(it, end);
+
+	const char* start = it;
+
+	while (it != end && !is_scalar_end(*it))
+		it++;
+
+	return it != start ? it : 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "json.hpp"
+
+#include <string_view>
+#include <vector>
+#include <utility>
+
+class fa_json_lazy;
+
+// Index of scalars other than strings and numbers (e.g. true or null), which no document accepts but a view can still point at
+#define FA_JSON_LAZY_OTHER 5
+
+// A value of a fa_json_lazy document, not decoded until asked for.
+// Views of missing values are empty (false). Valid as long as the document and its code live.
+class fa_json_lazy_value
+{
+public:
+	fa_json_lazy_value() = default;
+
+	explicit operator bool() const;
+
+	// One of FA_JSON_* values, told from the first character, or FA_JSON_LAZY_OTHER
+	size_t index() const;
+
+	// The unparsed text of the value
+	std::string_view raw() const;
+
+	// Decodes the value and everything in it
+	fa_json decode(fa_json_error* err) const;
+
+	// Decode scalars, returning an empty value when the type does not match
+	fa_json::integer get_integer() const;
+	fa_json::floating get_floating() const;
+	std::string get_string() const;
+
+	// Object member by key (first one of duplicates) and array element by index.
+	// Values in between are skipped using the structural index, without being decoded.
+	fa_json_lazy_value find(std::string_view key) const;
+	fa_json_lazy_value operator[](size_t i) const;
+
+	// Value at a JSON pointer (RFC 6901) relative to this one, e.g. "/configuration/base"
+	fa_json_lazy_value at(std::string_view pointer) const;
+
+	std::vector<fa_json_lazy_value> elements() const;
+
+	// Only the first of duplicate keys is kept, same as in fa_json
+	std::vector<std::pair<std::string, fa_json_lazy_value>> members() const;
+
+private:
+	friend class fa_json_lazy;
+
+	const fa_json_lazy* document = 0;
+	const char* begin = 0;
+	const char* end = 0;
+
+	fa_json_lazy_value(const fa_json_lazy* document, const char* begin, const char* end);
+
+	// Walks the members or elements, stopping when the callback returns false
+	template<typename F>
+	void for_each(F callback) const;
+};
+
+// JSON text with only a structural index built up front: where every object and array ends.
+// The text is checked once by fa_json_sax_parse, which builds nothing, so a document is rejected exactly when fa_json::parse rejects it.
+// Values are decoded on access, so reading a few fields of a large file costs little more than those two passes.
+class fa_json_lazy
+{
+public:
+	// The code has to outlive the document
+	void parse(std::string_view code, fa_json_error* err);
+
+	fa_json_lazy_value root() const;
+
+	// Same as root().at(pointer)
+	fa_json_lazy_value at(std::string_view pointer) const;
+
+private:
+	friend class fa_json_lazy_value;
+
+	std::string_view code;
+
+	// Offsets of every '{' and '[' and their matching closing bracket, sorted by the opening one
+	std::vector<std::pair<size_t, size_t>> containers;
+
+	// End of the value starting at it, or 0 if it is malformed
+	const char* skip_value(const char* it, const char* end) const;
+};
@@ -0,0 +1,479 @@
+#include "json_scan.hpp"
+
+#include <charconv>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FA_JSON_SCAN_X86
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FA_JSON_TARGET_AVX2
+#else
+#define FA_JSON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Index of the lowest set bit. The mask is never 0.
+static inline unsigned int lowest_bit(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Scalar
+
+static const char* skip_whitespace_scalar(const char* it, const char* end)
+{
+	while (it != end && fa_json_is_whitespace(*it))
+		it++;
+
+	return it;
+}
+
+static const char* find_string_special_scalar(const char* it, const char* end)
+{
+	while (it != end && *it != '"' && *it != '\\')
+		it++;
+
+	return it;
+}
+
+#ifdef FA_JSON_SCAN_X86
+
+// SSE2, 16 bytes at a time
+
+static const char* skip_whitespace_sse2(const char* it, const char* end)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i carriage_return = _mm_set1_epi8('\r');
+	const __m128i tab = _mm_set1_epi8('\t');
+
+	while (end - it >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*)it);
+
+		__m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, newline)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, carriage_return), _mm_cmpeq_epi8(chunk, tab))
+		);
+
+		unsigned int mask = ~(unsigned int)_mm_movemask_epi8(whitespace) & 0xFFFF;
+
+		if (mask)
+			return it + lowest_bit(mask);
+
+		it += 16;
+	}
+
+	return skip_whitespace_scalar(it, end);
+}
+
+static const char* find_string_special_sse2(const char* it, const char* end)
+{
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+
+	while (end - it >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*)it);
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(special);
+
+		if (mask)
+			return it + lowest_bit(mask);
+
+		it += 16;
+	}
+
+	return find_string_special_scalar(it, end);
+}
+
+// AVX2, 32 bytes at a time
+
+FA_JSON_TARGET_AVX2 static const char* skip_whitespace_avx2(const char* it, const char* end)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i carriage_return = _mm256_set1_epi8('\r');
+	const __m256i tab = _mm256_set1_epi8('\t');
+
+	while (end - it >= 32)
+	{
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)it);
+
+		__m256i whitespace = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, newline)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, carriage_return), _mm256_cmpeq_epi8(chunk, tab))
+		);
+
+		unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(whitespace);
+
+		if (mask)
+			return it + lowest_bit(mask);
+
+		it += 32;
+	}
+
+	return skip_whitespace_sse2(it, end);
+}
+
+FA_JSON_TARGET_AVX2 static const char* find_string_special_avx2(const char* it, const char* end)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+
+	while (end - it >= 32)
+	{
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)it);
+		__m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash));
+
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(special);
+
+		if (mask)
+			return it + lowest_bit(mask);
+
+		it += 32;
+	}
+
+	return find_string_special_sse2(it, end);
+}
+
+static bool cpu_supports_avx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+		return false;
+
+	// The OS has to save the AVX registers too
+	__cpuid(info, 1);
+
+	bool osxsave = info[2] & (1 << 27);
+	bool avx = info[2] & (1 << 28);
+
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+
+	return info[1] & (1 << 5);
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+fa_json_scan_kernel fa_json_best_scan_kernel()
+{
+#ifdef FA_JSON_SCAN_X86
+	static const bool avx2 = cpu_supports_avx2();
+
+	if (avx2)
+		return fa_json_scan_kernel::avx2;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return fa_json_scan_kernel::sse2;
+#endif
+#endif
+
+	return fa_json_scan_kernel::scalar;
+}
+
+static std::atomic<fa_json_scan_kernel> current_kernel(fa_json_scan_kernel::scalar);
+
+bool fa_json_use_scan_kernel(fa_json_scan_kernel kernel)
+{
+	fa_json_scan_kernel best = fa_json_best_scan_kernel();
+
+	if ((int)kernel > (int)best)
+		return false;
+
+	fa_json_scan_function skip_whitespace = skip_whitespace_scalar;
+	fa_json_scan_function find_string_special = find_string_special_scalar;
+
+#ifdef FA_JSON_SCAN_X86
+	if (kernel == fa_json_scan_kernel::sse2)
+	{
+		skip_whitespace = skip_whitespace_sse2;
+		find_string_special = find_string_special_sse2;
+	}
+	else if (kernel == fa_json_scan_kernel::avx2)
+	{
+		skip_whitespace = skip_whitespace_avx2;
+		find_string_special = find_string_special_avx2;
+	}
+#endif
+
+	fa_json_skip_whitespace_kernel.store(skip_whitespace, std::memory_order_relaxed);
+	fa_json_find_string_special_kernel.store(find_string_special, std::memory_order_relaxed);
+	current_kernel.store(kernel, std::memory_order_relaxed);
+
+	return true;
+}
+
+fa_json_scan_kernel fa_json_current_scan_kernel()
+{
+	return current_kernel.load(std::memory_order_relaxed);
+}
+
+const char* fa_json_scan_kernel_name(fa_json_scan_kernel kernel)
+{
+	switch (kernel)
+	{
+	case fa_json_scan_kernel::avx2:
+		return "avx2";
+
+	case fa_json_scan_kernel::sse2:
+		return "sse2";
+
+	default:
+		return "scalar";
+	}
+}
+
+// The kernels start as resolvers, which pick the best implementation on the first call.
+// Being constant-initialized, they are safe to use from other static initializers.
+
+static const char* resolve_skip_whitespace(const char* it, const char* end)
+{
+	fa_json_use_scan_kernel(fa_json_best_scan_kernel());
+	return fa_json_skip_whitespace_kernel.load(std::memory_order_relaxed)(it, end);
+}
+
+static const char* resolve_find_string_special(const char* it, const char* end)
+{
+	fa_json_use_scan_kernel(fa_json_best_scan_kernel());
+	return fa_json_find_string_special_kernel.load(std::memory_order_relaxed)(it, end);
+}
+
+std::atomic<fa_json_scan_function> fa_json_skip_whitespace_kernel(resolve_skip_whitespace);
+std::atomic<fa_json_scan_function> fa_json_find_string_special_kernel(resolve_find_string_special);
+
+
+// Numbers
+
+static const char* skip_digits(const char* it, const char* end)
+{
+	while (it != end && *it >= '0' && *it <= '9')
+		it++;
+
+	return it;
+}
+
+const char* fa_json_parse_number(const char* it, const char* end, fa_json_number& ret, fa_json_errno& error)
+{
+	// Find the extent of the number first, so that from_chars never accepts anything JSON does not (inf, nan, hex)
+	const char* number_end = it;
+
+	if (number_end != end && *number_end == '-')
+		number_end++;
+
+	const char* digits = number_end;
+	number_end = skip_digits(number_end, end);
+	size_t digit_count = number_end - digits;
+
+	ret.is_floating = false;
+
+	// Fraction. "1." and ".5" were accepted by the old parser, so they still are.
+	if (number_end != end && *number_end == '.')
+	{
+		ret.is_floating = true;
+
+		const char* fraction = ++number_end;
+		number_end = skip_digits(number_end, end);
+		digit_count += number_end - fraction;
+	}
+
+	if (!digit_count)
+	{
+		error = fa_json_errno::invalid_number;
+		return it;
+	}
+
+	// Exponent
+	if (number_end != end && (*number_end == 'e' || *number_end == 'E'))
+	{
+		ret.is_floating = true;
+
+		if (++number_end != end && (*number_end == '+' || *number_end == '-'))
+			number_end++;
+
+		const char* exponent = number_end;
+		number_end = skip_digits(number_end, end);
+
+		if (number_end == exponent)
+		{
+			error = fa_json_errno::invalid_number;
+			return it;
+		}
+	}
+
+	std::from_chars_result result;
+
+	if (ret.is_floating)
+		result = std::from_chars(it, number_end, ret.floating);
+	else
+		result = std::from_chars(it, number_end, ret.integer);
+
+	if (result.ec == std::errc::result_out_of_range)
+	{
+		error = fa_json_errno::number_out_of_range;
+		return it;
+	}
+
+	if (result.ec != std::errc() || result.ptr != number_end)
+	{
+		error = fa_json_errno::invalid_number;
+		return it;
+	}
+
+	return number_end;
+}
+
+char* fa_json_format_number(char* buffer, fa_json::integer value)
+{
+	return std::to_chars(buffer, buffer + FA_JSON_NUMBER_BUFFER, value).ptr;
+}
+
+char* fa_json_format_number(char* buffer, fa_json::floating value)
+{
+	if (!std::isfinite(value))
+		return 0;
+
+	char* end = std::to_chars(buffer, buffer + FA_JSON_NUMBER_BUFFER - 2, value).ptr;
+
+	// Keep the value floating after parsing it back
+	if (std::find_if(buffer, end, [](char c) -> bool { return c == '.' || c == 'e'; }) == end)
+	{
+		*end++ = '.';
+		*end++ = '0';
+	}
+
+	return end;
+}
+
+// Escapes
+
+static bool parse_hex4(const char*& it, const char* end, uint32_t& ret)
+{
+	ret = 0;
+
+	for (int i = 0; i < 4; i++, it++)
+	{
+		if (it == end)
+			return false;
+
+		ret <<= 4;
+
+		if (*it >= '0' && *it <= '9')
+			ret |= *it - '0';
+		else if (*it >= 'a' && *it <= 'f')
+			ret |= *it - 'a' + 10;
+		else if (*it >= 'A' && *it <= 'F')
+			ret |= *it - 'A' + 10;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+static size_t encode_utf8(uint32_t code_point, char* out)
+{
+	if (code_point < 0x80)
+	{
+		out[0] = (char)code_point;
+		return 1;
+	}
+
+	if (code_point < 0x800)
+	{
+		out[0] = (char)(0xC0 | (code_point >> 6));
+		out[1] = (char)(0x80 | (code_point & 0x3F));
+		return 2;
+	}
+
+	if (code_point < 0x10000)
+	{
+		out[0] = (char)(0xE0 | (code_point >> 12));
+		out[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		out[2] = (char)(0x80 | (code_point & 0x3F));
+		return 3;
+	}
+
+	out[0] = (char)(0xF0 | (code_point >> 18));
+	out[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+	out[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+	out[3] = (char)(0x80 | (code_point & 0x3F));
+	return 4;
+}
+
+size_t fa_json_decode_escape(const char*& it, const char* end, char* out, fa_json_errno& error)
+{
+	if (it == end)
+	{
+		error = fa_json_errno::end_of_input;
+		return 0;
+	}
+
+	switch (*it++)
+	{
+	case '"': *out = '"'; return 1;
+	case '\\': *out = '\\'; return 1;
+	case '/': *out = '/'; return 1;
+	case 'b': *out = '\b'; return 1;
+	case 'f': *out = '\f'; return 1;
+	case 'n': *out = '\n'; return 1;
+	case 'r': *out = '\r'; return 1;
+	case 't': *out = '\t'; return 1;
+
+	case 'u':
+	{
+		uint32_t code_point;
+
+		if (!parse_hex4(it, end, code_point))
+		{
+			error = it == end ? fa_json_errno::end_of_input : fa_json_errno::invalid_escape;
+			return 0;
+		}
+
+		// Characters outside of the basic plane are written as a surrogate pair
+		if (code_point >= 0xD800 && code_point <= 0xDBFF)
+		{
+			const char* low_it = it;
+			uint32_t low;
+
+			if (end - low_it >= 2 && low_it[0] == '\\' && low_it[1] == 'u' && parse_hex4(low_it += 2, end, low) && low >= 0xDC00 && low <= 0xDFFF)
+			{
+				code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+				it = low_it;
+			}
+			else
+				code_point = 0xFFFD;
+		}
+		else if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+			code_point = 0xFFFD;
+
+		return encode_utf8(code_point, out);
+	}
+
+	default:
+		it--;
+		error = fa_json_errno::invalid_escape;
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include "json.hpp"
+
+#include <atomic>
+
+// Scanning primitives shared by the JSON parsers.
+// Vector kernels are picked at runtime depending on what the CPU supports, the scalar ones are always available.
+
+// Fills in the error, with the position, line and column of at in source
+void fa_json_set_error(fa_json_error* err, fa_json_errno code, const std::string& description, std::string_view source, const char* at);
+
+enum class fa_json_scan_kernel
+{
+	scalar,
+	sse2,
+	avx2
+};
+
+using fa_json_scan_function = const char* (*)(const char* it, const char* end);
+
+extern std::atomic<fa_json_scan_function> fa_json_skip_whitespace_kernel;
+extern std::atomic<fa_json_scan_function> fa_json_find_string_special_kernel;
+
+inline bool fa_json_is_whitespace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Returns the first non-whitespace character in [it, end) or end
+inline const char* fa_json_skip_whitespace(const char* it, const char* end)
+{
+	// Tokens are mostly separated by a single space or nothing, which is not worth a vector load
+	if (it == end || !fa_json_is_whitespace(*it))
+		return it;
+
+	return fa_json_skip_whitespace_kernel.load(std::memory_order_relaxed)(it + 1, end);
+}
+
+// Returns the first '"' or '\' in [it, end) or end
+inline const char* fa_json_find_string_special(const char* it, const char* end)
+{
+	return fa_json_find_string_special_kernel.load(std::memory_order_relaxed)(it, end);
+}
+
+// The best kernel set supported by this CPU
+fa_json_scan_kernel fa_json_best_scan_kernel();
+
+// Switches all the parsers to the given kernel set. Returns false if the CPU does not support it.
+bool fa_json_use_scan_kernel(fa_json_scan_kernel kernel);
+
+fa_json_scan_kernel fa_json_current_scan_kernel();
+
+const char* fa_json_scan_kernel_name(fa_json_scan_kernel kernel);
+
+
+struct fa_json_number
+{
+	bool is_floating = false;
+	fa_json::integer integer = 0;
+	fa_json::floating floating = 0;
+};
+
+// Parses an exact number starting at it: -?digits(.digits)?([eE][+-]?digits)?
+// Numbers with a fraction or an exponent are floating, the rest are integers.
+// Returns the first character after the number, or it with the reason in error.
+const char* fa_json_parse_number(const char* it, const char* end, fa_json_number& ret, fa_json_errno& error);
+
+// Objects and arrays nested deeper than this are an error, so that the recursive parsers can not run out of stack
+#define FA_JSON_MAX_DEPTH 512
+
+#define FA_JSON_NUMBER_BUFFER 32
+
+// Writes the shortest text that parses back to the same value into a buffer of at least FA_JSON_NUMBER_BUFFER characters.
+// Returns the end of the text. Floating values always keep a '.' or an exponent.
+// JSON has no infinity or NaN, for those nothing is written and null is returned.
+char* fa_json_format_number(char* buffer, fa_json::integer value);
+char* fa_json_format_number(char* buffer, fa_json::floating value);
+
+// Decodes the escape sequence following a backslash and advances it past it.
+// Writes the character UTF-8 encoded into out (at most 4 bytes) and returns its length, or 0 with the reason in error.
+size_t fa_json_decode_escape(const char*& it, const char* end, char* out, fa_json_errno& error);
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "App.hpp"
+#include "AppBenchmark.hpp"
+#include "Trace.hpp"
 
 #include <memory>
 #include <iostream>
+#include <algorithm>
 
 int main(int argc, const char** argv)
 {
@@ -10,13 +13,23 @@ int main(int argc, const char** argv)
 	for (int i = 0; i < argc; i++)
 	{
 		cmd_args.push_back(argv[i]);
+
+		// Started before the app, so that its construction is traced too
+		if (cmd_args.back() == "-trace")
+			fa_Tracer::start();
 	}
 
+	FA_TRACE_THREAD("Main");
+
+	// Runs apps of its own in a generated folder, so none is created for the user's appdata
+	if (std::find(cmd_args.begin(), cmd_args.end(), "-benchmark") != cmd_args.end())
+		return fa_AppBenchmark::main(cmd_args, std::cout, std::cerr);
+
 	fa_App app;
 
 	app.run(cmd_args);
 
 	app.quit();
 
-	return 0;
+	return app.get_exit_code();
 }
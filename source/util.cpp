@@ -1,5 +1,7 @@
 #include "util.hpp"
 
+#include <cstring>
+
 namespace fa_util
 {
 	std::vector<std::string> split(const std::string& input, const std::string& delim)
@@ -20,4 +22,41 @@ namespace fa_util
 
 		return ret;
 	}
+
+	uint64_t hash(std::string_view data)
+	{
+		const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+
+		uint64_t ret = 0xCBF29CE484222325ull ^ data.size();
+		size_t i = 0;
+
+		// 8 bytes at a time, the tail is zero-padded
+		for (; i + 8 <= data.size(); i += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, data.data() + i, 8);
+
+			ret = (ret ^ word) * multiplier;
+			ret ^= ret >> 32;
+		}
+
+		uint64_t tail = 0;
+		std::memcpy(&tail, data.data() + i, data.size() - i);
+
+		ret = (ret ^ tail) * multiplier;
+		ret ^= ret >> 29;
+		ret *= multiplier;
+		ret ^= ret >> 32;
+
+		return ret;
+	}
+
+	bool is_bookkeeping_file(std::string_view name)
+	{
+		auto ends_with = [name](std::string_view suffix) {
+			return name.size() >= suffix.size() && name.substr(name.size() - suffix.size()) == suffix;
+		};
+
+		return ends_with(".fabin") || ends_with(".fabin.tmp");
+	}
 }
\ No newline at end of file
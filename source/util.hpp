@@ -1,8 +1,16 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstdint>
 
 namespace fa_util
 {
 	std::vector<std::string> split(const std::string& input, const std::string& delim);
+
+	// Fast non-cryptographic 64-bit hash, used to detect changed files
+	uint64_t hash(std::string_view data);
+
+	// Binary caches the game writes (".fabin") and their temporaries (".fabin.tmp"), which are never files of a mod
+	bool is_bookkeeping_file(std::string_view name);
 }
\ No newline at end of file